@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <jaffarCommon/hash.hpp>
+#include "level.hpp"
+
+namespace jaffar
+{
+
+// Visited-state set for push-level searches that stores each box configuration once, along with the pusher areas (by their
+// top-left square, see EmuInstance::getNormalizedPusherIndex()) it was reached with. States sharing a box layout differ only in
+// the pusher area, so each one costs a few bytes rather than a whole state or hash. Configurations are spread over shards by
+// hash, each an open-addressing table guarded by its own spin lock, so threads rarely contend. An entry takes 24 bytes and holds the
+// configuration's first three areas inline; the rare configurations reached with more spill into a shard-side list
+class BoxConfigurationSet
+{
+  public:
+
+  // The shard count is rounded up to a power of two
+  BoxConfigurationSet(const size_t shardCount = 256)
+  {
+    _shardBits = 0;
+    while (((size_t)1 << _shardBits) < shardCount) _shardBits++;
+    _shards = std::make_unique<shard_t[]>((size_t)1 << _shardBits);
+    for (size_t i = 0; i < ((size_t)1 << _shardBits); i++) _shards[i].resize(initialShardCapacity);
+  }
+
+  ~BoxConfigurationSet() = default;
+
+  // Inserts the state with the given box configuration and pusher area. Returns true if it was not in the set already
+  __INLINE__ bool insert(const jaffarCommon::hash::hash_t& boxHash, const quickerBan::cellIndex_t pusherArea)
+  {
+    auto& shard = getShard(boxHash);
+    lock(shard);
+
+    bool isNew = false;
+    auto& entry = shard.find(getKey(boxHash));
+    if (entry.key == emptyKey)
+    {
+      entry.key = getKey(boxHash);
+      entry.areas[0] = pusherArea;
+      shard.size++;
+      _configurationCount.fetch_add(1, std::memory_order_relaxed);
+      if (shard.size * 4 > shard.entries.size() * 3) shard.resize(shard.entries.size() * 2);
+      isNew = true;
+    }
+    else isNew = shard.addArea(entry, pusherArea);
+
+    unlock(shard);
+    if (isNew) _stateCount.fetch_add(1, std::memory_order_relaxed);
+    return isNew;
+  }
+
+  __INLINE__ bool contains(const jaffarCommon::hash::hash_t& boxHash, const quickerBan::cellIndex_t pusherArea)
+  {
+    auto& shard = getShard(boxHash);
+    lock(shard);
+    const auto& entry = shard.find(getKey(boxHash));
+    const bool isFound = entry.key != emptyKey && shard.hasArea(entry, pusherArea);
+    unlock(shard);
+    return isFound;
+  }
+
+  __INLINE__ size_t getConfigurationCount() const { return _configurationCount.load(std::memory_order_relaxed); }
+  __INLINE__ size_t getStateCount() const { return _stateCount.load(std::memory_order_relaxed); }
+
+  private:
+
+  static constexpr uint64_t emptyKey = 0;
+  static constexpr quickerBan::cellIndex_t noArea = std::numeric_limits<quickerBan::cellIndex_t>::max();
+  static constexpr uint32_t noOverflow = std::numeric_limits<uint32_t>::max();
+  static constexpr size_t inlineAreaCount = 3;
+  static constexpr size_t initialShardCapacity = 64;
+
+  struct entry_t
+  {
+    uint64_t key = emptyKey;
+    quickerBan::cellIndex_t areas[inlineAreaCount] = { noArea, noArea, noArea };
+    uint32_t overflow = noOverflow;
+  };
+
+  struct alignas(64) shard_t
+  {
+    // Returns the entry holding the key, or the empty one where it would go. The starting slot depends on the key alone (with a
+    // different mixing than the shard's), so entries can be placed again when the table grows
+    __INLINE__ entry_t& find(const uint64_t key)
+    {
+      size_t slot = (key * 0xC2B2AE3D27D4EB4Full) >> shift;
+      while (entries[slot].key != key && entries[slot].key != emptyKey) slot = (slot + 1) & mask;
+      return entries[slot];
+    }
+
+    __INLINE__ bool hasArea(const entry_t& entry, const quickerBan::cellIndex_t area) const
+    {
+      for (size_t i = 0; i < inlineAreaCount; i++) if (entry.areas[i] == area) return true;
+      if (entry.overflow == noOverflow) return false;
+      for (const auto overflowArea : overflows[entry.overflow]) if (overflowArea == area) return true;
+      return false;
+    }
+
+    // Adds an area to an existing entry. Returns false if it was already there
+    __INLINE__ bool addArea(entry_t& entry, const quickerBan::cellIndex_t area)
+    {
+      if (hasArea(entry, area)) return false;
+      for (size_t i = 0; i < inlineAreaCount; i++) if (entry.areas[i] == noArea) { entry.areas[i] = area; return true; }
+      if (entry.overflow == noOverflow) { entry.overflow = overflows.size(); overflows.emplace_back(); }
+      overflows[entry.overflow].push_back(area);
+      return true;
+    }
+
+    // Rebuilds the table with the given (power of two) capacity
+    void resize(const size_t capacity)
+    {
+      std::vector<entry_t> oldEntries(capacity);
+      std::swap(entries, oldEntries);
+      mask = capacity - 1;
+      shift = 64 - __builtin_ctzll(capacity);
+      for (const auto& entry : oldEntries) if (entry.key != emptyKey) find(entry.key) = entry;
+    }
+
+    std::atomic<bool> isLocked = false;
+    std::vector<entry_t> entries;
+    std::vector<std::vector<quickerBan::cellIndex_t>> overflows;
+    size_t size = 0;
+    size_t mask;
+    uint8_t shift;
+  };
+
+  // The stored key is the first half of the hash. The empty value is reserved, so a key equal to it is remapped
+  static __INLINE__ uint64_t getKey(const jaffarCommon::hash::hash_t& hash) { return hash.first == emptyKey ? 1 : hash.first; }
+
+  // The shard comes from the top bits of both hash halves mixed together (shifted in two steps, as there may be a single shard)
+  __INLINE__ shard_t& getShard(const jaffarCommon::hash::hash_t& hash) { return _shards[((hash.first ^ hash.second) * 0x9E3779B97F4A7C15ull) >> 1 >> (63 - _shardBits)]; }
+
+  static __INLINE__ void lock(shard_t& shard) { while (shard.isLocked.exchange(true, std::memory_order_acquire)) while (shard.isLocked.load(std::memory_order_relaxed)); }
+  static __INLINE__ void unlock(shard_t& shard) { shard.isLocked.store(false, std::memory_order_release); }
+
+  std::unique_ptr<shard_t[]> _shards;
+  uint8_t _shardBits;
+  std::atomic<size_t> _configurationCount = 0;
+  std::atomic<size_t> _stateCount = 0;
+};
+
+} // namespace jaffar
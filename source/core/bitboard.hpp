@@ -0,0 +1,219 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <array>
+#include <type_traits>
+#include <vector>
+#include <jaffarCommon/exceptions.hpp>
+
+namespace quickerBan {
+
+// Fixed-size bit set over the cells of a room, indexed the same way as Room::getIndex().
+// Cell neighbourhoods are read as small bit windows, and whole-board operations work a word at a time.
+// With FixedWords = 0 the words are heap allocated on resize(). Otherwise they are held inline and every whole-board loop has a
+// compile-time bound, which is what the room variants specialized for small boards use
+template <size_t FixedWords = 0>
+class BasicBitboard
+{
+  template <size_t> friend class BasicBitboard;
+
+  public:
+
+  BasicBitboard() = default;
+  ~BasicBitboard() = default;
+
+  // Bitboards operating together must have the same word count, so the minimum word count allows padding a heap allocated
+  // bitboard to match inline ones of a larger capacity. Padding bits are never set
+  __INLINE__ void resize(const size_t bitCount, const size_t minWordCount = 0)
+  {
+    _bitCount = bitCount;
+    _wordCount = std::max((bitCount + 63) / 64, minWordCount);
+
+    // An extra padding word allows reading bit windows that straddle the last word without bounds checks
+    if constexpr (FixedWords == 0) _words.assign(_wordCount + 1, 0);
+    if constexpr (FixedWords > 0)
+    {
+      if (_wordCount > FixedWords) JAFFAR_THROW_LOGIC("Bitboard of %lu bits exceeds its fixed capacity of %lu words", bitCount, FixedWords);
+      _wordCount = FixedWords;
+      _words.fill(0);
+    }
+  }
+
+  __INLINE__ size_t size() const { return _bitCount; }
+  __INLINE__ size_t getWordCount() const { if constexpr (FixedWords > 0) return FixedWords; else return _wordCount; }
+  __INLINE__ uint64_t getWord(const size_t w) const { return _words[w]; }
+
+  __INLINE__ bool test(const size_t i) const { return (_words[i >> 6] >> (i & 63)) & 1; }
+  __INLINE__ void set(const size_t i) { _words[i >> 6] |= 1ull << (i & 63); }
+  __INLINE__ void clear(const size_t i) { _words[i >> 6] &= ~(1ull << (i & 63)); }
+  __INLINE__ void reset() { for (size_t w = 0; w < getWordCount(); w++) _words[w] = 0; }
+
+  // Returns 'n' (up to 57) consecutive bits starting at position 'i', with bit 'i' in the least significant position
+  __INLINE__ uint64_t getBits(const size_t i, const uint8_t n) const
+  {
+    const size_t word = i >> 6;
+    const size_t offset = i & 63;
+    uint64_t value = _words[word] >> offset;
+    if (offset + n > 64) value |= _words[word + 1] << (64 - offset);
+    return value & ((1ull << n) - 1);
+  }
+
+  __INLINE__ size_t popcount() const
+  {
+    size_t count = 0;
+    for (size_t w = 0; w < getWordCount(); w++) count += __builtin_popcountll(_words[w]);
+    return count;
+  }
+
+  // Counts the bits set in both this and the other bitboard, without materializing the intersection
+  template <size_t OtherWords>
+  __INLINE__ size_t andPopcount(const BasicBitboard<OtherWords>& other) const
+  {
+    size_t count = 0;
+    for (size_t w = 0; w < getWordCount(); w++) count += __builtin_popcountll(_words[w] & other._words[w]);
+    return count;
+  }
+
+  __INLINE__ bool any() const
+  {
+    for (size_t w = 0; w < getWordCount(); w++) if (_words[w] != 0) return true;
+    return false;
+  }
+
+  template <size_t OtherWords>
+  __INLINE__ bool intersects(const BasicBitboard<OtherWords>& other) const
+  {
+    for (size_t w = 0; w < getWordCount(); w++) if ((_words[w] & other._words[w]) != 0) return true;
+    return false;
+  }
+
+  // Returns the index of the lowest set bit, or size() if none is set
+  __INLINE__ size_t findFirst() const
+  {
+    for (size_t w = 0; w < getWordCount(); w++) if (_words[w] != 0) return w * 64 + __builtin_ctzll(_words[w]);
+    return _bitCount;
+  }
+
+  __INLINE__ void invert()
+  {
+    for (size_t w = 0; w < getWordCount(); w++) _words[w] = ~_words[w];
+    clearPadding();
+  }
+
+  template <size_t OtherWords> __INLINE__ void copyFrom(const BasicBitboard<OtherWords>& other) { for (size_t w = 0; w < getWordCount(); w++) _words[w] = other._words[w]; }
+  template <size_t OtherWords> __INLINE__ void andWith(const BasicBitboard<OtherWords>& other) { for (size_t w = 0; w < getWordCount(); w++) _words[w] &= other._words[w]; }
+  template <size_t OtherWords> __INLINE__ void andNotWith(const BasicBitboard<OtherWords>& other) { for (size_t w = 0; w < getWordCount(); w++) _words[w] &= ~other._words[w]; }
+  template <size_t OtherWords> __INLINE__ void orWith(const BasicBitboard<OtherWords>& other) { for (size_t w = 0; w < getWordCount(); w++) _words[w] |= other._words[w]; }
+
+  // ORs into this bitboard the other one shifted by 'shift' positions (positive shifts move bits towards higher indices)
+  template <size_t OtherWords>
+  __INLINE__ void orShifted(const BasicBitboard<OtherWords>& other, const int64_t shift)
+  {
+    const size_t wordCount = getWordCount();
+    if (shift >= 0)
+    {
+      const size_t wordShift = shift >> 6;
+      const size_t bitShift = shift & 63;
+      for (size_t w = wordCount; w-- > wordShift;)
+      {
+        uint64_t value = other._words[w - wordShift] << bitShift;
+        if (bitShift > 0 && w > wordShift) value |= other._words[w - wordShift - 1] >> (64 - bitShift);
+        _words[w] |= value;
+      }
+    }
+    else
+    {
+      const size_t wordShift = (-shift) >> 6;
+      const size_t bitShift = (-shift) & 63;
+      for (size_t w = 0; w + wordShift < wordCount; w++)
+      {
+        uint64_t value = other._words[w + wordShift] >> bitShift;
+        if (bitShift > 0 && w + wordShift + 1 < wordCount) value |= other._words[w + wordShift + 1] << (64 - bitShift);
+        _words[w] |= value;
+      }
+    }
+
+    // Bits shifted past the end of the board are discarded
+    clearPadding();
+  }
+
+  template <size_t OtherWords>
+  __INLINE__ bool operator==(const BasicBitboard<OtherWords>& other) const
+  {
+    for (size_t w = 0; w < getWordCount(); w++) if (_words[w] != other._words[w]) return false;
+    return true;
+  }
+
+  // Fills this bitboard with the cells connected to 'start' through non-blocked cells of a board 'stride' cells wide, growing the
+  // region one step in every direction per iteration. 'scratch' holds the previous region and must be of the same size
+  template <size_t BlockedWords>
+  __INLINE__ void floodFill(const size_t start, const BasicBitboard<BlockedWords>& blocked, const size_t stride, BasicBitboard& scratch)
+  {
+    reset();
+    set(start);
+    do
+    {
+      scratch.copyFrom(*this);
+      orShifted(scratch, 1);
+      orShifted(scratch, -1);
+      orShifted(scratch, stride);
+      orShifted(scratch, -(int64_t)stride);
+      andNotWith(blocked);
+    } while (!(*this == scratch));
+  }
+
+  // Same as above, but filling the region one run of consecutive cells at a time, from a stack of seed cells. Its cost depends on
+  // the size of the region rather than on the size of the board times its width, which suits large boards. Neighbours are
+  // taken as in the shift-based fill (the cells one apart and 'stride' apart, within the board). 'start' must not be blocked
+  template <size_t BlockedWords>
+  __INLINE__ void floodFill(const size_t start, const BasicBitboard<BlockedWords>& blocked, const size_t stride, std::vector<uint32_t>& seeds)
+  {
+    reset();
+    seeds.assign(1, start);
+    while (seeds.empty() == false)
+    {
+      size_t first = seeds.back();
+      seeds.pop_back();
+      if (test(first)) continue;
+
+      // Extending the run both ways and filling it
+      size_t last = first;
+      while (first > 0 && blocked.test(first - 1) == false && test(first - 1) == false) first--;
+      while (last + 1 < _bitCount && blocked.test(last + 1) == false && test(last + 1) == false) last++;
+      for (size_t i = first; i <= last; i++) set(i);
+
+      // Seeding the free runs next to it, one stride before and after
+      for (const int64_t shift : { -(int64_t)stride, (int64_t)stride })
+      {
+        bool isInRun = false;
+        for (size_t i = first; i <= last; i++)
+        {
+          const int64_t next = (int64_t)i + shift;
+          const bool isFree = next >= 0 && next < (int64_t)_bitCount && blocked.test(next) == false && test(next) == false;
+          if (isFree && isInRun == false) seeds.push_back(next);
+          isInRun = isFree;
+        }
+      }
+    }
+  }
+
+  private:
+
+  // Clears the bits past the end of the board
+  __INLINE__ void clearPadding()
+  {
+    const size_t lastWord = _bitCount >> 6;
+    if (_bitCount & 63) _words[lastWord] &= (1ull << (_bitCount & 63)) - 1;
+    for (size_t w = lastWord + ((_bitCount & 63) ? 1 : 0); w < getWordCount(); w++) _words[w] = 0;
+  }
+
+  std::conditional_t<FixedWords == 0, std::vector<uint64_t>, std::array<uint64_t, FixedWords + 1>> _words {};
+  size_t _wordCount = 0;
+  size_t _bitCount = 0;
+};
+
+typedef BasicBitboard<> Bitboard;
+
+} // namespace quickerBan
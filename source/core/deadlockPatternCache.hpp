@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <jaffarCommon/exceptions.hpp>
+#include <jaffarCommon/file.hpp>
+
+namespace quickerBan {
+
+// Cache of freeze deadlock verdicts over local windows of the board, shared by any number of rooms and threads. A window is the
+// 5x5 square centered on a pushed box, described by which of its cells are walls, boxes, goals and dead squares; whenever the
+// freeze analysis of that box only looked at cells within the window, its verdict depends on nothing else, so it holds for any
+// box anywhere with the same surroundings, in this or any other level. Lookups are lock-free reads and new verdicts are added
+// with a compare-and-swap, so after a warm-up the table is read-mostly. Once full, new verdicts are simply not cached
+class DeadlockPatternCache
+{
+  public:
+
+  // Side of the window, and how far from its center the boxes examined by the freeze analysis may be for the verdict to depend
+  // only on the window (their neighbours must be in it too)
+  static constexpr int windowSize = 5;
+  static constexpr int localRadius = windowSize / 2 - 1;
+
+  enum verdict_t
+  {
+    unknown = 0,
+    safe,
+    deadlock
+  };
+
+  // The capacity is rounded up to a power of two
+  DeadlockPatternCache(const size_t capacity = 1 << 20)
+  {
+    _capacity = 2;
+    _shift = 63;
+    while (_capacity < capacity) { _capacity <<= 1; _shift--; }
+    _mask = _capacity - 1;
+    _slots = std::make_unique<std::atomic<uint64_t>[]>(_capacity);
+    for (size_t i = 0; i < _capacity; i++) _slots[i].store(emptySlot, std::memory_order_relaxed);
+  }
+
+  ~DeadlockPatternCache() = default;
+
+  // Builds the key of a window from its wall, box, goal and dead square rows (windowSize bits each, the leftmost cell in the
+  // lowest bit). The lowest key bit is left for the verdict
+  static __INLINE__ uint64_t getKey(const uint64_t* walls, const uint64_t* boxes, const uint64_t* goals, const uint64_t* deads)
+  {
+    uint64_t first = 0, second = 0;
+    for (int i = 0; i < windowSize; i++)
+    {
+      first = (first << (2 * windowSize)) | (walls[i] << windowSize) | boxes[i];
+      second = (second << (2 * windowSize)) | (goals[i] << windowSize) | deads[i];
+    }
+
+    uint64_t key = (first ^ (second * 0x9E3779B97F4A7C15ull)) * 0xC2B2AE3D27D4EB4Full;
+    key ^= key >> 29;
+    key &= ~verdictMask;
+    return key == emptySlot ? 2 : key;
+  }
+
+  __INLINE__ verdict_t lookup(const uint64_t key) const
+  {
+    size_t slot = key >> _shift;
+    for (size_t probes = 0; probes < _capacity; probes++)
+    {
+      const uint64_t entry = _slots[slot].load(std::memory_order_relaxed);
+      if (entry == emptySlot) return unknown;
+      if ((entry & ~verdictMask) == key) return (entry & verdictMask) ? deadlock : safe;
+      slot = (slot + 1) & _mask;
+    }
+    return unknown;
+  }
+
+  __INLINE__ void insert(const uint64_t key, const bool isDeadlock)
+  {
+    // Leaving some room free keeps probe sequences short, and guarantees lookups find an empty slot
+    if (_size.load(std::memory_order_relaxed) * 4 >= _capacity * 3) return;
+
+    const uint64_t entry = key | (isDeadlock ? verdictMask : 0);
+    size_t slot = key >> _shift;
+    while (true)
+    {
+      uint64_t current = _slots[slot].load(std::memory_order_relaxed);
+      if (current == emptySlot)
+      {
+        if (_slots[slot].compare_exchange_strong(current, entry, std::memory_order_relaxed)) { _size.fetch_add(1, std::memory_order_relaxed); return; }
+      }
+      if ((current & ~verdictMask) == key) return;
+      slot = (slot + 1) & _mask;
+    }
+  }
+
+  __INLINE__ size_t size() const { return _size.load(std::memory_order_relaxed); }
+
+  // Loads the verdicts stored in the given file into this cache. Returns false if the file could not be read
+  bool load(const std::string& path)
+  {
+    std::string data;
+    if (jaffarCommon::file::loadStringFromFile(data, path) == false) return false;
+    if (data.size() < sizeof(fileMagic) || data.size() % sizeof(uint64_t) != 0) JAFFAR_THROW_RUNTIME("[Error] Corrupt deadlock pattern file: %s", path.c_str());
+
+    uint64_t magic;
+    memcpy(&magic, data.data(), sizeof(magic));
+    if (magic != fileMagic) JAFFAR_THROW_RUNTIME("[Error] Corrupt deadlock pattern file: %s", path.c_str());
+
+    for (size_t pos = sizeof(fileMagic); pos < data.size(); pos += sizeof(uint64_t))
+    {
+      uint64_t entry;
+      memcpy(&entry, &data[pos], sizeof(entry));
+      insert(entry & ~verdictMask, entry & verdictMask);
+    }
+    return true;
+  }
+
+  // Saves every verdict in this cache to the given file. Returns false if it could not be written
+  bool save(const std::string& path) const
+  {
+    std::string data((size() + 1) * sizeof(uint64_t), '\0');
+    memcpy(data.data(), &fileMagic, sizeof(fileMagic));
+    size_t pos = sizeof(fileMagic);
+    for (size_t i = 0; i < _capacity && pos < data.size(); i++)
+    {
+      const uint64_t entry = _slots[i].load(std::memory_order_relaxed);
+      if (entry == emptySlot) continue;
+      memcpy(&data[pos], &entry, sizeof(entry));
+      pos += sizeof(entry);
+    }
+    data.resize(pos);
+    return jaffarCommon::file::saveStringToFile(data, path);
+  }
+
+  private:
+
+  static constexpr uint64_t emptySlot = 0;
+  static constexpr uint64_t verdictMask = 1;
+  static constexpr uint64_t fileMagic = 0x3130544150444251ull;
+
+  std::unique_ptr<std::atomic<uint64_t>[]> _slots;
+  std::atomic<size_t> _size = 0;
+  size_t _capacity;
+  size_t _mask;
+  uint8_t _shift;
+};
+
+} // namespace quickerBan
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <variant>
 #include <jaffarCommon/hash.hpp>
 #include <jaffarCommon/exceptions.hpp>
 #include <jaffarCommon/file.hpp>
@@ -11,6 +12,7 @@
 #include <jaffarCommon/deserializers/contiguous.hpp>
 #include "inputParser.hpp"
 #include "room.hpp"
+#include "levelCollection.hpp"
 
 namespace jaffar
 {
@@ -19,11 +21,52 @@ class EmuInstance;
 
 class EmuInstance
 {
+  // Calls the given function on the room variant selected at initialization. Defined first, since their return types are deduced
+  template <typename F> __INLINE__ decltype(auto) visitRoom(F&& function) { return std::visit(std::forward<F>(function), _room); }
+  template <typename F> __INLINE__ decltype(auto) visitRoom(F&& function) const { return std::visit(std::forward<F>(function), _room); }
+
   public:
 
   EmuInstance(const nlohmann::json &config)
   {
     _inputRoomFilePath = jaffarCommon::json::getString(config, "Input Room File");
+
+    // Optional selection of a level within a room file holding a collection, by index (starting at zero) or title
+    if (config.contains("Input Room Index")) _inputRoomIndex = jaffarCommon::json::getNumber<size_t>(config, "Input Room Index");
+    if (config.contains("Input Room Title")) _inputRoomTitle = jaffarCommon::json::getString(config, "Input Room Title");
+    if (_inputRoomIndex != SIZE_MAX && _inputRoomTitle.empty() == false) JAFFAR_THROW_LOGIC("Only one of 'Input Room Index' and 'Input Room Title' can be given\n");
+
+    // Optional heuristic selection
+    if (config.contains("Heuristic Type"))
+    {
+      const auto heuristicType = jaffarCommon::json::getString(config, "Heuristic Type");
+      bool heuristicTypeRecognized = false;
+      if (heuristicType == "Nearest Goal") { _heuristicType = quickerBan::Room::heuristicType::nearestGoal; heuristicTypeRecognized = true; }
+      if (heuristicType == "Minimum Matching") { _heuristicType = quickerBan::Room::heuristicType::minimumMatching; heuristicTypeRecognized = true; }
+      if (heuristicTypeRecognized == false) JAFFAR_THROW_LOGIC("Unrecognized heuristic type: %s\n", heuristicType.c_str());
+    }
+
+    // Optional saved state format selection
+    if (config.contains("State Format"))
+    {
+      const auto stateFormat = jaffarCommon::json::getString(config, "State Format");
+      bool stateFormatRecognized = false;
+      if (stateFormat == "Raw") { _stateFormat = quickerBan::Room::stateFormat::raw; stateFormatRecognized = true; }
+      if (stateFormat == "Packed") { _stateFormat = quickerBan::Room::stateFormat::packed; stateFormatRecognized = true; }
+      if (stateFormatRecognized == false) JAFFAR_THROW_LOGIC("Unrecognized state format: %s\n", stateFormat.c_str());
+    }
+
+    // Optional pusher position normalization for saved states and hashes
+    if (config.contains("Normalize Pusher Position")) _isNormalizedState = jaffarCommon::json::getBoolean(config, "Normalize Pusher Position");
+
+    // Optional use of the room variants specialized for small levels (enabled by default)
+    if (config.contains("Use Specialized Rooms")) _isSpecializedRoomEnabled = jaffarCommon::json::getBoolean(config, "Use Specialized Rooms");
+
+    // Optional deadlock pattern cache, kept next to the room file (disabled by default)
+    if (config.contains("Use Deadlock Pattern Cache")) _isDeadlockPatternCacheEnabled = jaffarCommon::json::getBoolean(config, "Use Deadlock Pattern Cache");
+
+    // Optional tunnel and goal room macros following each push (disabled by default)
+    if (config.contains("Use Push Macros")) _isPushMacroEnabled = jaffarCommon::json::getBoolean(config, "Use Push Macros");
     // _biosFilePath = jaffarCommon::json::getString(config, "Bios File Path");
     // _inputParser = std::make_unique<jaffar::InputParser>(config);
   }
@@ -35,40 +78,119 @@ class EmuInstance
     // Setting input
     auto inputValue = input.key;
 
-    _isDeadlock = true;
-    if (inputValue == InputKey_t::UP) _isDeadlock = _room.move(-1, 0);
-    if (inputValue == InputKey_t::DOWN) _isDeadlock = _room.move(1, 0);
-    if (inputValue == InputKey_t::RIGHT) _isDeadlock = _room.move(0, 1);
-    if (inputValue == InputKey_t::LEFT) _isDeadlock = _room.move(0, -1);
+    _isDeadlock = visitRoom([&](auto& room)
+    {
+      if (inputValue == InputKey_t::UP) return room.move(-1, 0);
+      if (inputValue == InputKey_t::DOWN) return room.move(1, 0);
+      if (inputValue == InputKey_t::RIGHT) return room.move(0, 1);
+      if (inputValue == InputKey_t::LEFT) return room.move(0, -1);
+      return true;
+    });
   }
 
-  inline jaffarCommon::hash::hash_t getStateHash() const
+  // Same as advanceState(), but also records the delta needed to revert the move with undoState()
+  void advanceState(const jaffar::input_t &input, quickerBan::Room::moveDelta_t &delta)
   {
-    MetroHash128 hash;
-    
-    //  Getting RAM pointer and size
-    hash.Update(_room.getState(), _room.getStateSize());
+    auto inputValue = input.key;
 
-    jaffarCommon::hash::hash_t result;
-    hash.Finalize(reinterpret_cast<uint8_t *>(&result));
-    return result;
+    _isDeadlock = visitRoom([&](auto& room)
+    {
+      if (inputValue == InputKey_t::UP) return room.move(-1, 0, &delta);
+      if (inputValue == InputKey_t::DOWN) return room.move(1, 0, &delta);
+      if (inputValue == InputKey_t::RIGHT) return room.move(0, 1, &delta);
+      if (inputValue == InputKey_t::LEFT) return room.move(0, -1, &delta);
+      return true;
+    });
   }
 
+  // Reverts a move in constant time. Deadlocked states are not expanded, so the deadlock flag of the restored state is cleared
+  void undoState(const quickerBan::Room::moveDelta_t &delta)
+  {
+    visitRoom([&](auto& room) { room.undo(delta); });
+    _isDeadlock = false;
+  }
+
+  // Returns the room's incrementally maintained Zobrist hash. In 64-bit builds the second half is always zero
+  inline jaffarCommon::hash::hash_t getStateHash() const { return toHash(visitRoom([&](auto& room) { return room.getStateHash(); })); }
+
+  // Hash of the box configuration alone, and the top-left square of the pusher's area. Together they identify a state in the
+  // same way the normalized state hash does
+  inline jaffarCommon::hash::hash_t getBoxHash() const { return toHash(visitRoom([&](auto& room) { return room.getBoxHash(); })); }
+  inline quickerBan::cellIndex_t getNormalizedPusherIndex() const { return visitRoom([&](auto& room) { return room.getNormalizedPusherIndex(); }); }
+
   void initialize()
   {
-    // Reading from input file
-    std::string inputRoomData;
-    bool        status = jaffarCommon::file::loadStringFromFile(inputRoomData, _inputRoomFilePath.c_str());
-    if (status == false) JAFFAR_THROW_LOGIC("Could not find/read from input sok file: %s\n", _inputRoomFilePath.c_str());
+    // Reading the selected level from a collection, or the whole input file as a single level
+    std::shared_ptr<const quickerBan::Level> level;
+    if (_inputRoomIndex != SIZE_MAX || _inputRoomTitle.empty() == false)
+    {
+      const quickerBan::LevelCollection collection(_inputRoomFilePath);
+      level = _inputRoomTitle.empty() ? collection.getLevel(_inputRoomIndex, _isPushMacroEnabled) : collection.getLevel(_inputRoomTitle, _isPushMacroEnabled);
+    }
+    else
+    {
+      std::string inputRoomData;
+      bool        status = jaffarCommon::file::loadStringFromFile(inputRoomData, _inputRoomFilePath.c_str());
+      if (status == false) JAFFAR_THROW_LOGIC("Could not find/read from input sok file: %s\n", _inputRoomFilePath.c_str());
+      level = std::make_shared<const quickerBan::Level>(inputRoomData, _isPushMacroEnabled);
+    }
 
-    _room.parse(inputRoomData);
+    // Loading the patterns learned by previous runs, if any
+    if (_isDeadlockPatternCacheEnabled)
+    {
+      _deadlockPatternCache = std::make_shared<quickerBan::DeadlockPatternCache>();
+      _deadlockPatternCache->load(getDeadlockPatternFilePath());
+    }
 
-    _stateSize = _room.getStateSize();
+    initialize(level);
   }
 
+  // Initializes this instance on an already loaded level, which is shared rather than copied. This lets any number of instances
+  // (e.g., one per worker thread) play the same level while holding only their own state
+  void initialize(const std::shared_ptr<const quickerBan::Level>& level)
+  {
+    // Selecting the most specialized room variant the level fits in
+    if (_isSpecializedRoomEnabled && quickerBan::Room8x8::isCompatible(*level)) _room.emplace<quickerBan::Room8x8>();
+    else if (_isSpecializedRoomEnabled && quickerBan::Room16x8::isCompatible(*level)) _room.emplace<quickerBan::Room16x8>();
+    else if (_isSpecializedRoomEnabled && quickerBan::Room16x16::isCompatible(*level)) _room.emplace<quickerBan::Room16x16>();
+    else if (quickerBan::Room::isCompatible(*level)) _room.emplace<quickerBan::Room>();
+    else _room.emplace<quickerBan::RoomWide>();
+
+    visitRoom([&](auto& room)
+    {
+      room.initialize(level);
+      room.setHeuristicType(_heuristicType);
+      room.setNormalizedState(_isNormalizedState);
+      room.setStateFormat(_stateFormat);
+      room.setDeadlockPatternCache(_deadlockPatternCache);
+      room.setPushMacrosEnabled(_isPushMacroEnabled);
+    });
+
+    _stateSize = visitRoom([](auto& room) { return room.getStateSize(); });
+  }
+
+  // The deadlock pattern cache in use, if any. Instances playing the same level (e.g., one per worker thread) can share it
+  inline const std::shared_ptr<quickerBan::DeadlockPatternCache>& getDeadlockPatternCache() const { return _deadlockPatternCache; }
+  inline void setDeadlockPatternCache(const std::shared_ptr<quickerBan::DeadlockPatternCache>& cache)
+  {
+    _deadlockPatternCache = cache;
+    visitRoom([&](auto& room) { room.setDeadlockPatternCache(_deadlockPatternCache); });
+  }
+
+  // Saves the deadlock patterns learned so far next to the room file, for later runs to start from
+  inline void saveDeadlockPatternCache() const
+  {
+    if (_deadlockPatternCache == nullptr) return;
+    if (_deadlockPatternCache->save(getDeadlockPatternFilePath()) == false) JAFFAR_THROW_LOGIC("Could not write deadlock pattern file: %s\n", getDeadlockPatternFilePath().c_str());
+  }
+
+  inline std::string getDeadlockPatternFilePath() const { return _inputRoomFilePath + ".patterns"; }
+
+  inline const std::shared_ptr<const quickerBan::Level>& getLevel() const { return visitRoom([](auto& room) -> const std::shared_ptr<const quickerBan::Level>& { return room.getLevel(); }); }
+
   void printInfo()
   {
-     _room.printMap();
+     visitRoom([&](auto& room) { room.printMap(); });
 
     //  // Getting state
     //  jaffarCommon::logger::log("[] Possible Moves: { ");
@@ -79,19 +201,42 @@ class EmuInstance
     //  jaffarCommon::logger::log(" }\n");
   }
 
-  inline bool canMoveUp() const {return _room.canMoveUp(); }
-  inline bool canMoveDown() const {return _room.canMoveDown(); }
-  inline bool canMoveLeft() const {return _room.canMoveLeft(); }
-  inline bool canMoveRight() const {return _room.canMoveRight(); }
-  inline size_t getBoxesOnGoal() const {return _room.getBoxesOnGoal(); }
-  inline size_t getGoalCount() const {return _room.getGoalCount(); }
-  inline bool getMovedBox() const { return _room.getMovedBox(); }
+  inline bool canMoveUp() const {return visitRoom([&](auto& room) { return room.canMoveUp(); }); }
+  inline bool canMoveDown() const {return visitRoom([&](auto& room) { return room.canMoveDown(); }); }
+  inline bool canMoveLeft() const {return visitRoom([&](auto& room) { return room.canMoveLeft(); }); }
+  inline bool canMoveRight() const {return visitRoom([&](auto& room) { return room.canMoveRight(); }); }
+  inline size_t getBoxesOnGoal() const {return visitRoom([&](auto& room) { return room.getBoxesOnGoal(); }); }
+  inline size_t getGoalCount() const {return visitRoom([&](auto& room) { return room.getGoalCount(); }); }
+  inline bool getMovedBox() const { return visitRoom([&](auto& room) { return room.getMovedBox(); }); }
   inline bool getIsDeadlock() const { return _isDeadlock; }
-  inline uint32_t getTotalDistance() { return _room.getTotalDistanceToGoal(); }
+  inline bool getIsCorralDeadlock() { return visitRoom([&](auto& room) { return room.checkCorralDeadlock(); }); }
+  inline uint32_t getTotalDistance() { return visitRoom([&](auto& room) { return room.getTotalDistanceToGoal(); }); }
+
+  // Writes the records of all children of the current state (hash, input, moved box and deadlock flags, and serialized state)
+  // into the given buffer, which must hold four records of getChildRecordSize() bytes. Returns the number of children
+  inline size_t expandAll(uint8_t* buffer) { return visitRoom([&](auto& room) { return room.expandAll(buffer); }); }
+  inline size_t getChildRecordSize() const { return visitRoom([&](auto& room) { return room.getChildRecordSize(); }); }
+
+  // Push-level interface: enumerates the legal pushes, applies one (walk and macro included), and expands one into the LURD
+  // inputs that perform it. The input string must be obtained before the push is applied, and the inputs of its macro after
+  inline void getPushes(std::vector<quickerBan::Room::push_t>& pushes) { visitRoom([&](auto& room) { room.getPushes(pushes); }); }
+  inline void advancePush(const quickerBan::Room::push_t& push) { _isDeadlock = visitRoom([&](auto& room) { return room.applyPush(push); }); }
+  inline void advancePush(const quickerBan::Room::push_t& push, quickerBan::Room::moveDelta_t& delta) { _isDeadlock = visitRoom([&](auto& room) { return room.applyPush(push, &delta); }); }
+  inline void getPushInputString(const quickerBan::Room::push_t& push, std::string& inputString) const { visitRoom([&](auto& room) { room.getPushInputString(push, inputString); }); }
+  inline void getLastMacroInputString(std::string& inputString) const { visitRoom([&](auto& room) { room.getLastMacroInputString(inputString); }); }
+  inline size_t getLastPushCount() const { return visitRoom([](auto& room) { return room.getLastPushCount(); }); }
 
-  inline uint8_t* getState() const 
+  // Backward (pull) interface: the solved states to start from, one per pusher area, the legal pulls, applying one, and the
+  // forward push that reverts it. Pulled states hash and serialize like forward ones
+  inline void getSolvedPusherStarts(std::vector<quickerBan::cellIndex_t>& starts) { visitRoom([&](auto& room) { room.getSolvedPusherStarts(starts); }); }
+  inline void setSolvedState(const quickerBan::cellIndex_t pusherIdx) { visitRoom([&](auto& room) { room.setSolvedState(pusherIdx); }); _isDeadlock = false; }
+  inline void getPulls(std::vector<quickerBan::Room::push_t>& pulls) { visitRoom([&](auto& room) { room.getPulls(pulls); }); }
+  inline void advancePull(const quickerBan::Room::push_t& pull) { visitRoom([&](auto& room) { room.applyPull(pull); }); _isDeadlock = false; }
+  inline quickerBan::Room::push_t getReversePush(const quickerBan::Room::push_t& pull) const { return visitRoom([&](auto& room) { return room.getReversePush(pull); }); }
+
+  inline const uint8_t* getState() const 
   {
-    return _room.getState();
+    return visitRoom([&](auto& room) { return room.getState(); });
   }
 
   inline size_t getStateSize() const 
@@ -103,22 +248,39 @@ class EmuInstance
   
   void serializeState(jaffarCommon::serializer::Base& s) const
   {
-    _room.saveState(s);
+    visitRoom([&](auto& room) { room.saveState(s); });
   }
 
   void deserializeState(jaffarCommon::deserializer::Base& d) 
   {
-    _room.loadState(d);
+    visitRoom([&](auto& room) { room.loadState(d); });
   }
 
   std::string getCoreName() const { return "QuickerBan"; }
 
   private:
 
+  static __INLINE__ jaffarCommon::hash::hash_t toHash(const quickerBan::stateHash_t hash)
+  {
+    jaffarCommon::hash::hash_t result;
+    result.first = (uint64_t)hash;
+    result.second = (uint64_t)(hash >> 32 >> 32);
+    return result;
+  }
+
   size_t _stateSize;
   std::unique_ptr<jaffar::InputParser> _inputParser;
   std::string _inputRoomFilePath;
-  quickerBan::Room _room;
+  size_t _inputRoomIndex = SIZE_MAX;
+  std::string _inputRoomTitle;
+  std::variant<quickerBan::Room, quickerBan::Room8x8, quickerBan::Room16x8, quickerBan::Room16x16, quickerBan::RoomWide> _room;
+  bool _isSpecializedRoomEnabled = true;
+  bool _isDeadlockPatternCacheEnabled = false;
+  bool _isPushMacroEnabled = false;
+  std::shared_ptr<quickerBan::DeadlockPatternCache> _deadlockPatternCache;
+  quickerBan::Room::heuristicType _heuristicType = quickerBan::Room::heuristicType::nearestGoal;
+  bool _isNormalizedState = false;
+  quickerBan::Room::stateFormat _stateFormat = quickerBan::Room::stateFormat::raw;
   bool _isDeadlock = false;
 };
 
@@ -0,0 +1,597 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <jaffarCommon/string.hpp>
+#include <jaffarCommon/exceptions.hpp>
+#include "bitboard.hpp"
+
+// Width of the Zobrist state hash, selected at build time (64 or 128 bits)
+#ifndef _QUICKERBAN_ZOBRIST_HASH_BITS
+  #define _QUICKERBAN_ZOBRIST_HASH_BITS 128
+#endif
+
+namespace quickerBan {
+
+// Index of a cell in row-major order (row * stride + column). 32 bits wide, so rooms of any size can be indexed
+typedef uint32_t cellIndex_t;
+
+#if _QUICKERBAN_ZOBRIST_HASH_BITS == 128
+  typedef __uint128_t stateHash_t;
+#elif _QUICKERBAN_ZOBRIST_HASH_BITS == 64
+  typedef uint64_t stateHash_t;
+#else
+  #error "Unsupported Zobrist hash width, use 64 or 128"
+#endif
+
+// Everything about a level that does not change while playing it: the room layout, its initial state and the tables derived
+// from them at parse time. A level is read-only once built, so any number of rooms (on any number of threads) can share one
+// through a std::shared_ptr<const Level> instead of each holding its own copy
+class Level
+{
+  public:
+
+  // Push distance for squares from which a goal cannot be reached
+  static constexpr uint16_t unreachableDistance = UINT16_MAX;
+
+  // Largest cell count (row stride included) handled by the specialized room variants. Levels within it get their bitboards
+  // padded to this many cells, so the variants' inline bitboards can operate with them directly
+  static constexpr size_t maxSpecializedCellCount = 256;
+
+  // Largest goal room (in squares) for which packing macros are worked out
+  static constexpr size_t maxGoalRoomCellCount = 64;
+
+  // One step of a macro: a move in the given direction, which pushes a box or just walks
+  struct macroStep_t
+  {
+    int8_t deltaY;
+    int8_t deltaX;
+    bool isPush;
+  };
+
+  // A dead-end area holding goals that boxes can only enter through one square, pushed in one direction. Boxes are packed in a
+  // fixed order, worked out at parse time, and for each number of goals already filled, the room holds the moves that take a box
+  // just pushed onto the entrance (with the pusher right behind it) to the next goal in that order
+  struct goalRoom_t
+  {
+    Bitboard cells;
+    cellIndex_t entrance;
+    int8_t deltaY;
+    int8_t deltaX;
+    std::vector<Bitboard> filledGoals;
+    std::vector<std::vector<macroStep_t>> macros;
+  };
+
+  enum itemType
+  {
+    wall = 0,
+    floor,
+    pusher,
+    pusher_on_goal,
+    box,
+    box_on_goal,
+    goal
+  };
+
+  // Tunnels and goal rooms are only worked out if push macros are to be used, as finding the goal rooms of a large level takes
+  // much longer than the rest of the parse
+  Level(const std::string& roomString, const bool isPushMacroEnabled = false) : _isPushMacroEnabled(isPushMacroEnabled) { parse(roomString); }
+  ~Level() = default;
+
+  __INLINE__ uint16_t getWidth() const { return _width; }
+  __INLINE__ uint16_t getHeight() const { return _height; }
+  __INLINE__ uint16_t getStride() const { return _stride; }
+  __INLINE__ size_t getCellCount() const { return _cellCount; }
+  __INLINE__ size_t getBoxCount() const { return _boxCount; }
+  __INLINE__ size_t getGoalCount() const { return _goalCount; }
+
+  // Initial pusher cell and box cells, boxes in row-major order
+  __INLINE__ cellIndex_t getInitialPusher() const { return _initialPusher; }
+  __INLINE__ const std::vector<cellIndex_t>& getInitialBoxes() const { return _initialBoxes; }
+
+  __INLINE__ const Bitboard& getWallBits() const { return _wallBits; }
+  __INLINE__ const Bitboard& getGoalBits() const { return _goalBits; }
+  __INLINE__ const Bitboard& getFloorBits() const { return _floorBits; }
+  __INLINE__ const Bitboard& getDeadBits() const { return _deadBits; }
+
+  // Whether tunnels and goal rooms were worked out, so that rooms playing this level can use push macros
+  __INLINE__ bool isPushMacroEnabled() const { return _isPushMacroEnabled; }
+
+  // Tunnel squares along each axis: floor squares with walls on both sides across it (left and right for vertical tunnels, above
+  // and below for horizontal ones)
+  __INLINE__ const Bitboard& getTunnelBits(const bool isVertical) const { return _tunnelBits[isVertical ? 1 : 0]; }
+
+  // Entrances of the goal rooms, and the goal room entered through the given square
+  __INLINE__ const Bitboard& getGoalRoomEntranceBits() const { return _goalRoomEntranceBits; }
+  __INLINE__ const goalRoom_t& getGoalRoom(const cellIndex_t entrance) const
+  {
+    for (const auto& goalRoom : _goalRooms) if (goalRoom.entrance == entrance) return goalRoom;
+    JAFFAR_THROW_LOGIC("Square %u is not a goal room entrance", entrance);
+  }
+
+  __INLINE__ const std::vector<cellIndex_t>& getGoals() const { return _goals; }
+  __INLINE__ uint16_t getPushDistance(const cellIndex_t index, const size_t goal) const { return _goalDistances[goal * _cellCount + index]; }
+  __INLINE__ uint16_t getMinPushDistance(const cellIndex_t index) const { return _minGoalDistances[index]; }
+
+  __INLINE__ cellIndex_t getDenseIndex(const cellIndex_t index) const { return _denseIndexes[index]; }
+  __INLINE__ cellIndex_t getDenseCell(const cellIndex_t denseIndex) const { return _denseCells[denseIndex]; }
+  __INLINE__ size_t getPackedPusherSize() const { return _packedPusherSize; }
+  __INLINE__ size_t getPackedStateSize() const { return _packedStateSize; }
+
+  __INLINE__ stateHash_t getPusherKey(const cellIndex_t index) const { return _pusherKeys[index]; }
+  __INLINE__ stateHash_t getBoxKey(const cellIndex_t index) const { return _boxKeys[index]; }
+
+  __INLINE__ cellIndex_t getIndex(const uint16_t i, const uint16_t j) const { return (cellIndex_t)i * _stride + j; }
+
+  private:
+
+  __INLINE__ void parse(const std::string& roomString)
+  {
+    const auto rowSequence = jaffarCommon::string::split(roomString, '\n');
+
+    // Getting room size
+    size_t width = 0;
+    for (const auto& row : rowSequence) width = std::max(width, row.size());
+    if (rowSequence.size() > UINT16_MAX || width > UINT16_MAX) JAFFAR_THROW_LOGIC("Room size %lux%lu exceeds the maximum of %u squares per side", width, rowSequence.size(), UINT16_MAX);
+    _height = rowSequence.size();
+    _width = width;
+
+    // Rooms of up to 8x8 or 16x16 squares are laid out with a row stride of 8 or 16 cells, the constant strides used by the
+    // specialized room variants. Cells past the end of a row are walls
+    _stride = _width;
+    if (_width <= 16 && _height <= 16) _stride = 16;
+    if (_width <= 8 && _height <= 8) _stride = 8;
+    _cellCount = (size_t)_height * _stride;
+
+    // Parse-time tile map, cleared to floor
+    std::vector<uint8_t> tiles(_cellCount, itemType::floor);
+    for (uint16_t i = 0; i < _height; i++)
+     for (uint16_t j = _width; j < _stride; j++) tiles[getIndex(i,j)] = itemType::wall;
+
+    // Parsing from input
+    _boxCount = 0;
+    _goalCount = 0;
+    for (uint16_t i = 0; i < _height; i++)
+    {
+        const auto& row = rowSequence[i];
+        for (uint16_t j = 0; j < row.size(); j++)
+        {
+            if (row[j] == ' ' || row[j] == '-' || row[j] == '_') tiles[getIndex(i,j)] = itemType::floor;
+            if (row[j] == '.') { tiles[getIndex(i,j)] = itemType::goal; _goalCount++; }
+            if (row[j] == '*' || row[j] == 'B') { tiles[getIndex(i,j)] = itemType::box_on_goal; _boxCount++; _goalCount++; }
+            if (row[j] == 'b' || row[j] == '$') { tiles[getIndex(i,j)] = itemType::box; _boxCount++;  }
+            if (row[j] == 'P' || row[j] == '+') { tiles[getIndex(i,j)] = itemType::pusher_on_goal; _goalCount++; }
+            if (row[j] == 'p' || row[j] == '@') tiles[getIndex(i,j)] = itemType::pusher;
+            if (row[j] == '#') tiles[getIndex(i,j)] = itemType::wall;
+        }
+    }
+
+    // Sanity check: boxes = goals
+    if (_boxCount != _goalCount) JAFFAR_THROW_LOGIC("Number of boxes (%lu) is not equal to goals (%lu)", _boxCount, _goalCount);
+
+    // Getting the initial pusher and box cells
+    _initialBoxes.clear();
+    for (cellIndex_t i = 0; i < _cellCount; i++)
+    {
+       if (tiles[i] == itemType::pusher || tiles[i] == itemType::pusher_on_goal) _initialPusher = i;
+       if (tiles[i] == itemType::box || tiles[i] == itemType::box_on_goal) _initialBoxes.push_back(i);
+    }
+
+    // Building static bitboards
+    const size_t minWordCount = _cellCount <= maxSpecializedCellCount ? maxSpecializedCellCount / 64 : 0;
+    _wallBits.resize(_cellCount, minWordCount);
+    _goalBits.resize(_cellCount, minWordCount);
+    _floorBits.resize(_cellCount, minWordCount);
+    for (cellIndex_t i = 0; i < _cellCount; i++)
+    {
+      if (tiles[i] == itemType::wall) _wallBits.set(i);
+      if (tiles[i] == itemType::goal || tiles[i] == itemType::pusher_on_goal || tiles[i] == itemType::box_on_goal) _goalBits.set(i);
+    }
+
+    // Building the reachable floor by flood filling from the pusher through anything that is not a wall
+    Bitboard floodBits;
+    floodBits.resize(_cellCount, minWordCount);
+    _floorBits.floodFill(_initialPusher, _wallBits, _stride, floodBits);
+
+    // Building push distance tables and dead squares
+    _deadBits.resize(_cellCount, minWordCount);
+    updateDistanceTables();
+
+    // Finding tunnels and goal rooms, for push macros
+    if (_isPushMacroEnabled)
+    {
+      updateTunnels();
+      updateGoalRooms();
+    }
+
+    // Building dense indexes for the packed state format
+    updateDenseIndexes();
+
+    // Building Zobrist keys
+    updateZobristKeys();
+  }
+
+  // Computes, for each goal, the minimum number of pushes needed to bring a box from every square to it. A box can get from a
+  // square to a goal only if, starting from that goal, the box can be pulled back to the square: each pull needs the target
+  // square and the one behind it (where the pusher ends up) to be reachable floor. Boxes are ignored, so these are static
+  // properties of the room. Squares from which no goal can be reached are dead squares
+  __INLINE__ void updateDistanceTables()
+  {
+    const int offsets[4] = { -(int)_stride, (int)_stride, -1, 1 };
+
+    // Getting goal indexes
+    _goals.clear();
+    for (cellIndex_t i = 0; i < _cellCount; i++) if (_goalBits.test(i)) _goals.push_back(i);
+
+    _goalDistances.assign(_goals.size() * _cellCount, unreachableDistance);
+    _minGoalDistances.assign(_cellCount, unreachableDistance);
+
+    // Breadth-first pull search from each goal
+    std::vector<cellIndex_t> queue;
+    queue.reserve(_cellCount);
+    for (size_t goal = 0; goal < _goals.size(); goal++)
+    {
+      uint16_t* distances = &_goalDistances[goal * _cellCount];
+      distances[_goals[goal]] = 0;
+      queue.clear();
+      queue.push_back(_goals[goal]);
+
+      for (size_t q = 0; q < queue.size(); q++)
+       for (const auto offset : offsets)
+       {
+         const int target = (int)queue[q] + offset;
+         const int pusher = target + offset;
+         if (pusher < 0 || pusher >= (int)_cellCount) continue;
+         if (_floorBits.test(target) == false || _floorBits.test(pusher) == false) continue;
+         if (distances[target] != unreachableDistance) continue;
+         distances[target] = distances[queue[q]] + 1;
+         queue.push_back(target);
+       }
+
+      for (size_t i = 0; i < _cellCount; i++) _minGoalDistances[i] = std::min(_minGoalDistances[i], distances[i]);
+    }
+
+    // Dead squares are the reachable floor squares that no goal can be pulled back to
+    for (cellIndex_t i = 0; i < _cellCount; i++) if (_floorBits.test(i) && _minGoalDistances[i] == unreachableDistance) _deadBits.set(i);
+  }
+
+  __INLINE__ void updateTunnels()
+  {
+    for (size_t axis = 0; axis < 2; axis++)
+    {
+      _tunnelBits[axis].resize(_cellCount, _wallBits.getWordCount());
+      const int side = axis == 1 ? 1 : (int)_stride;
+      for (cellIndex_t i = _stride; i + _stride < _cellCount; i++)
+       if (_floorBits.test(i) && _wallBits.test(i - side) && _wallBits.test(i + side)) _tunnelBits[axis].set(i);
+    }
+  }
+
+  // Finds the cut squares of the reachable floor, those whose removal splits it, with an iterative depth-first search (Tarjan's
+  // algorithm, as levels can be too large for recursion). The search starts from the pusher's square, which is not examined
+  // itself since no goal room can be entered through it
+  __INLINE__ std::vector<cellIndex_t> getCutSquares() const
+  {
+    const int offsets[4] = { -(int)_stride, (int)_stride, -1, 1 };
+
+    struct frame_t
+    {
+      cellIndex_t cell;
+      cellIndex_t parent;
+      uint8_t direction;
+    };
+
+    std::vector<uint32_t> order(_cellCount, 0);
+    std::vector<uint32_t> low(_cellCount, 0);
+    std::vector<frame_t> stack = { frame_t { _initialPusher, _initialPusher, 0 } };
+    std::vector<cellIndex_t> cutSquares;
+    uint32_t counter = 1;
+    order[_initialPusher] = low[_initialPusher] = counter;
+
+    while (stack.empty() == false)
+    {
+      // Visiting the next neighbour of the square on top
+      auto& frame = stack.back();
+      if (frame.direction < 4)
+      {
+        const cellIndex_t cell = frame.cell;
+        const cellIndex_t next = cell + offsets[frame.direction++];
+        if (_floorBits.test(next) == false) continue;
+        if (order[next] == 0) { order[next] = low[next] = ++counter; stack.push_back(frame_t { next, cell, 0 }); }
+        else if (next != frame.parent) low[cell] = std::min(low[cell], order[next]);
+        continue;
+      }
+
+      // Done with this square: its parent is a cut square if nothing below it reaches above the parent
+      const cellIndex_t cell = frame.cell;
+      const cellIndex_t parent = frame.parent;
+      stack.pop_back();
+      if (stack.empty()) break;
+      low[parent] = std::min(low[parent], low[cell]);
+      if (parent != _initialPusher && low[cell] >= order[parent]) cutSquares.push_back(parent);
+    }
+
+    std::sort(cutSquares.begin(), cutSquares.end());
+    cutSquares.erase(std::unique(cutSquares.begin(), cutSquares.end()), cutSquares.end());
+    return cutSquares;
+  }
+
+  // A goal room is found by cutting the floor at a non-goal cut square: if the part beyond one of its neighbours is only
+  // connected through that neighbour, holds goals, and holds neither the pusher nor any box at the start, boxes can only get to
+  // those goals by being pushed through the square in that direction. That part is flood filled only up to the largest room
+  // size, marking squares with the fill's number so that nothing needs clearing between fills. Larger rooms are preferred over
+  // the smaller ones inside them. Rooms for which no packing order is found are dropped
+  __INLINE__ void updateGoalRooms()
+  {
+    const int offsets[4] = { -(int)_stride, (int)_stride, -1, 1 };
+    const int8_t directions[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+
+    Bitboard initialBits;
+    initialBits.resize(_cellCount, _wallBits.getWordCount());
+    initialBits.set(_initialPusher);
+    for (const auto box : _initialBoxes) initialBits.set(box);
+
+    // Gathering candidates, each with the list of its squares
+    std::vector<uint32_t> marks(_cellCount, 0);
+    uint32_t fillNumber = 0;
+    std::vector<cellIndex_t> fillCells;
+    std::vector<std::pair<goalRoom_t, std::vector<cellIndex_t>>> candidates;
+    for (const auto entrance : getCutSquares())
+    {
+      if (_goalBits.test(entrance) || initialBits.test(entrance)) continue;
+
+      for (size_t d = 0; d < 4; d++)
+      {
+        const cellIndex_t inside = entrance + offsets[d];
+        const cellIndex_t outside = entrance - offsets[d];
+        if (_floorBits.test(inside) == false || _floorBits.test(outside) == false || initialBits.test(inside)) continue;
+
+        fillNumber++;
+        marks[entrance] = fillNumber;
+        marks[inside] = fillNumber;
+        fillCells.assign(1, inside);
+        bool isRoom = true;
+        for (size_t q = 0; q < fillCells.size() && isRoom; q++)
+         for (const auto offset : offsets)
+         {
+           const cellIndex_t next = fillCells[q] + offset;
+           if (_floorBits.test(next) == false || marks[next] == fillNumber) continue;
+           if (next == outside || initialBits.test(next) || fillCells.size() == maxGoalRoomCellCount) { isRoom = false; break; }
+           marks[next] = fillNumber;
+           fillCells.push_back(next);
+         }
+        if (isRoom == false) continue;
+
+        bool isSingleEntry = true;
+        for (size_t e = 0; e < 4; e++) if (e != d && marks[entrance + offsets[e]] == fillNumber) isSingleEntry = false;
+        if (isSingleEntry == false) continue;
+
+        bool hasGoals = false;
+        for (const auto cell : fillCells) hasGoals |= _goalBits.test(cell);
+        if (hasGoals == false) continue;
+
+        goalRoom_t goalRoom;
+        goalRoom.cells.resize(_cellCount, _wallBits.getWordCount());
+        for (const auto cell : fillCells) goalRoom.cells.set(cell);
+        goalRoom.entrance = entrance;
+        goalRoom.deltaY = directions[d][0];
+        goalRoom.deltaX = directions[d][1];
+        candidates.emplace_back(std::move(goalRoom), fillCells);
+      }
+    }
+
+    // Keeping the largest non-overlapping candidates that can be packed
+    std::stable_sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) { return a.second.size() > b.second.size(); });
+    _goalRooms.clear();
+    _goalRoomEntranceBits.resize(_cellCount, _wallBits.getWordCount());
+    Bitboard takenBits;
+    takenBits.resize(_cellCount, _wallBits.getWordCount());
+    std::vector<int> localIndexes(_cellCount, -1);
+    for (auto& [candidate, cells] : candidates)
+    {
+      if (candidate.cells.intersects(takenBits) || takenBits.test(candidate.entrance)) continue;
+      if (updatePackingMacros(candidate, cells, localIndexes) == false) continue;
+      takenBits.orWith(candidate.cells);
+      takenBits.set(candidate.entrance);
+      _goalRoomEntranceBits.set(candidate.entrance);
+      _goalRooms.push_back(std::move(candidate));
+    }
+  }
+
+  // Works out the packing order of a goal room and the moves that pack each box, filling the farthest goal (from the entrance)
+  // that a box can still be brought to at each step. The pusher is kept within the room, its entrance and the square behind it.
+  // Takes the room's squares, and a board-sized scratch table of local indexes, all -1, which is left that way. Returns false if
+  // some goal cannot be filled this way
+  __INLINE__ bool updatePackingMacros(goalRoom_t& goalRoom, const std::vector<cellIndex_t>& roomCells, std::vector<int>& localIndexes)
+  {
+    const int offsets[4] = { -(int)_stride, (int)_stride, -1, 1 };
+    const int8_t directions[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+    const cellIndex_t entryOffset = goalRoom.deltaY * (int)_stride + goalRoom.deltaX;
+
+    // Local numbering of the squares involved: the room, its entrance, and the square behind it
+    std::vector<cellIndex_t> cells = roomCells;
+    cells.push_back(goalRoom.entrance);
+    cells.push_back(goalRoom.entrance - entryOffset);
+    const size_t localCount = cells.size();
+    for (size_t i = 0; i < localCount; i++) localIndexes[cells[i]] = i;
+    const size_t pusherOnlyLocal = localCount - 1;
+
+    // Room goals, farthest (in walking distance from the entrance) first
+    std::vector<size_t> distances(localCount, SIZE_MAX);
+    std::vector<size_t> queue = { localCount - 2 };
+    distances[localCount - 2] = 0;
+    for (size_t q = 0; q < queue.size(); q++)
+     for (const auto offset : offsets)
+     {
+       const int next = localIndexes[cells[queue[q]] + offset];
+       if (next < 0 || (size_t)next == pusherOnlyLocal || distances[next] != SIZE_MAX) continue;
+       distances[next] = distances[queue[q]] + 1;
+       queue.push_back(next);
+     }
+
+    std::vector<size_t> goals;
+    for (size_t i = 0; i < localCount - 2; i++) if (_goalBits.test(cells[i])) goals.push_back(i);
+    std::stable_sort(goals.begin(), goals.end(), [&](const size_t a, const size_t b) { return distances[a] > distances[b]; });
+
+    // Breadth-first search over box and pusher squares (node = box * localCount + pusher), one move at a time
+    std::vector<bool> isFilled(localCount, false);
+    std::vector<uint32_t> parents(localCount * localCount);
+    std::vector<uint8_t> moves(localCount * localCount);
+    const auto findPath = [&](const size_t goal, std::vector<macroStep_t>& steps)
+    {
+      const uint32_t unvisited = UINT32_MAX;
+      std::fill(parents.begin(), parents.end(), unvisited);
+      const uint32_t start = (localCount - 2) * localCount + pusherOnlyLocal;
+      std::vector<uint32_t> nodes = { start };
+      parents[start] = start;
+
+      for (size_t q = 0; q < nodes.size(); q++)
+      {
+        const size_t box = nodes[q] / localCount;
+        const size_t pusher = nodes[q] % localCount;
+        if (box == goal)
+        {
+          // Rebuilding the moves from the goal back to the start
+          steps.clear();
+          for (uint32_t node = nodes[q]; node != start; node = parents[node])
+          {
+            const auto move = moves[node];
+            steps.push_back(macroStep_t { directions[move & 3][0], directions[move & 3][1], (move & 4) != 0 });
+          }
+          std::reverse(steps.begin(), steps.end());
+          return true;
+        }
+
+        for (size_t d = 0; d < 4; d++)
+        {
+          const int nextPusher = localIndexes[cells[pusher] + offsets[d]];
+          if (nextPusher < 0 || isFilled[nextPusher]) continue;
+
+          size_t nextBox = box;
+          if ((size_t)nextPusher == box)
+          {
+            const int pushedBox = localIndexes[cells[box] + offsets[d]];
+            if (pushedBox < 0 || (size_t)pushedBox == pusherOnlyLocal || isFilled[pushedBox]) continue;
+            nextBox = pushedBox;
+          }
+
+          const uint32_t next = nextBox * localCount + nextPusher;
+          if (parents[next] != unvisited) continue;
+          parents[next] = nodes[q];
+          moves[next] = d | ((size_t)nextPusher == box ? 4 : 0);
+          nodes.push_back(next);
+        }
+      }
+
+      return false;
+    };
+
+    // Filling the goals one by one
+    goalRoom.filledGoals.clear();
+    goalRoom.macros.clear();
+    Bitboard filledBits;
+    filledBits.resize(_cellCount, _wallBits.getWordCount());
+    bool isPacked = true;
+    for (size_t k = 0; k < goals.size() && isPacked; k++)
+    {
+      goalRoom.filledGoals.push_back(filledBits);
+      goalRoom.macros.emplace_back();
+
+      isPacked = false;
+      for (const auto goal : goals) if (isFilled[goal] == false && findPath(goal, goalRoom.macros.back()))
+      {
+        isFilled[goal] = true;
+        filledBits.set(cells[goal]);
+        isPacked = true;
+        break;
+      }
+    }
+
+    // Leaving the local index table as it was given
+    for (const auto cell : cells) localIndexes[cell] = -1;
+    return isPacked;
+  }
+
+  // Assigns consecutive dense indexes, in row-major order, to the reachable floor squares: the only ones a box or the pusher can
+  // ever occupy. The packed format stores the pusher's dense index (in as few bytes as the number of such squares allows),
+  // followed by one occupancy bit per dense square
+  __INLINE__ void updateDenseIndexes()
+  {
+    _denseIndexes.assign(_cellCount, UINT32_MAX);
+    _denseCells.clear();
+    for (cellIndex_t i = 0; i < _cellCount; i++) if (_floorBits.test(i)) { _denseIndexes[i] = _denseCells.size(); _denseCells.push_back(i); }
+
+    _packedPusherSize = 1;
+    while (_packedPusherSize < sizeof(cellIndex_t) && (_denseCells.size() - 1) >> (8 * _packedPusherSize) != 0) _packedPusherSize++;
+    _packedStateSize = _packedPusherSize + (_denseCells.size() + 7) / 8;
+  }
+
+  // Generates one random key per square for the pusher and one for a box. A fixed seed makes hashes reproducible across runs and
+  // instances. Keys are drawn in row-major square order, so they do not depend on the row stride
+  __INLINE__ void updateZobristKeys()
+  {
+    _pusherKeys.assign(_cellCount, 0);
+    _boxKeys.assign(_cellCount, 0);
+
+    uint64_t seed = 0x5175696B65724261ull;
+    const auto nextRandom = [&seed]()
+    {
+      // SplitMix64
+      uint64_t z = (seed += 0x9E3779B97F4A7C15ull);
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+      return z ^ (z >> 31);
+    };
+
+    for (uint16_t y = 0; y < _height; y++)
+    for (uint16_t x = 0; x < _width; x++)
+    {
+      const auto i = getIndex(y, x);
+      _pusherKeys[i] = nextRandom();
+      _boxKeys[i] = nextRandom();
+#if _QUICKERBAN_ZOBRIST_HASH_BITS == 128
+      _pusherKeys[i] = (_pusherKeys[i] << 64) | nextRandom();
+      _boxKeys[i] = (_boxKeys[i] << 64) | nextRandom();
+#endif
+    }
+  }
+
+  uint16_t _width = 0;
+  uint16_t _height = 0;
+  uint16_t _stride = 0;
+  size_t _cellCount = 0;
+  size_t _boxCount = 0;
+  size_t _goalCount = 0;
+  cellIndex_t _initialPusher = 0;
+  std::vector<cellIndex_t> _initialBoxes;
+
+  // Static bitboards: walls, goals, the floor reachable by the pusher (ignoring boxes) and dead squares
+  Bitboard _wallBits;
+  Bitboard _goalBits;
+  Bitboard _floorBits;
+  Bitboard _deadBits;
+
+  // Tunnel squares (horizontal, vertical) and goal rooms, if push macros are enabled
+  bool _isPushMacroEnabled = false;
+  Bitboard _tunnelBits[2];
+  Bitboard _goalRoomEntranceBits;
+  std::vector<goalRoom_t> _goalRooms;
+
+  // Goal indexes and per-goal push distance tables (goal-major), plus the minimum over all goals for each square
+  std::vector<cellIndex_t> _goals;
+  std::vector<uint16_t> _goalDistances;
+  std::vector<uint16_t> _minGoalDistances;
+
+  // Dense square indexes for the packed state format
+  std::vector<cellIndex_t> _denseIndexes;
+  std::vector<cellIndex_t> _denseCells;
+  size_t _packedPusherSize = 1;
+  size_t _packedStateSize = 0;
+
+  // Zobrist keys per cell
+  std::vector<stateHash_t> _pusherKeys;
+  std::vector<stateHash_t> _boxKeys;
+};
+
+} // namespace quickerBan
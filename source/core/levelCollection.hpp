@@ -0,0 +1,187 @@
+#pragma once
+
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <jaffarCommon/exceptions.hpp>
+#include "room.hpp"
+
+namespace quickerBan {
+
+// Read-only view of a level collection in the usual .sok / .xsb text format: boards made of consecutive rows of level squares,
+// separated by any other lines (blank lines, comments, titles, metadata). The file is memory-mapped and scanned once, line by
+// line, to index where each board starts and ends and what its title is; boards themselves are only parsed when a level is
+// requested, so opening a collection of thousands of levels costs a single pass over its text.
+//
+// A level's title is taken from a 'Title:' line between its board and the next one if there is such a line. Otherwise it is
+// the last non-blank line before its board that is neither part of a board nor metadata ('Key: value', like 'Author: ...'), with
+// any leading ';' comment mark removed. Levels without either are untitled
+class LevelCollection
+{
+  public:
+
+  struct levelEntry_t
+  {
+    size_t offset;
+    size_t size;
+    std::string title;
+  };
+
+  LevelCollection(const std::string& path)
+  {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) JAFFAR_THROW_RUNTIME("[Error] Could not open level collection '%s'", path.c_str());
+    struct stat fileStat;
+    fstat(fd, &fileStat);
+    _size = fileStat.st_size;
+    if (_size > 0) _data = (const char*)mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (_data == MAP_FAILED) JAFFAR_THROW_RUNTIME("[Error] Could not map level collection '%s'", path.c_str());
+
+    // The collection is read from start to end once
+    if (_data != nullptr) madvise((void*)_data, _size, MADV_SEQUENTIAL);
+    buildIndex();
+  }
+
+  ~LevelCollection() { if (_data != nullptr) munmap((void*)_data, _size); }
+
+  LevelCollection(const LevelCollection&) = delete;
+  LevelCollection& operator=(const LevelCollection&) = delete;
+
+  __INLINE__ size_t getLevelCount() const { return _levels.size(); }
+  __INLINE__ const levelEntry_t& getLevelEntry(const size_t index) const { checkIndex(index); return _levels[index]; }
+  __INLINE__ const std::string& getTitle(const size_t index) const { checkIndex(index); return _levels[index].title; }
+
+  // Returns the index of the first level with the given title
+  __INLINE__ size_t findLevel(const std::string& title) const
+  {
+    for (size_t i = 0; i < _levels.size(); i++) if (_levels[i].title == title) return i;
+    JAFFAR_THROW_LOGIC("[Error] Level collection has no level titled '%s'", title.c_str());
+  }
+
+  // Returns the board of the given level as accepted by Level, one row per line, without carriage returns or trailing spaces
+  __INLINE__ std::string getLevelString(const size_t index) const
+  {
+    checkIndex(index);
+    std::string levelString;
+    levelString.reserve(_levels[index].size);
+    const std::string_view board(_data + _levels[index].offset, _levels[index].size);
+    for (size_t pos = 0; pos < board.size();)
+    {
+      const auto line = getLine(board, pos);
+      if (levelString.empty() == false) levelString.push_back('\n');
+      levelString.append(line);
+    }
+    return levelString;
+  }
+
+  // Parses the given level, which can then be shared by any number of rooms. Push macros are worked out only if requested
+  __INLINE__ std::shared_ptr<const Level> getLevel(const size_t index, const bool isPushMacroEnabled = false) const { return std::make_shared<const Level>(getLevelString(index), isPushMacroEnabled); }
+  __INLINE__ std::shared_ptr<const Level> getLevel(const std::string& title, const bool isPushMacroEnabled = false) const { return getLevel(findLevel(title), isPushMacroEnabled); }
+
+  // Builds a room of the given variant (which the level must fit in) playing the given level
+  template <class RoomType = Room>
+  __INLINE__ RoomType getRoom(const size_t index) const
+  {
+    const auto level = getLevel(index);
+    if (RoomType::isCompatible(*level) == false) JAFFAR_THROW_LOGIC("[Error] Level %lu does not fit in the requested room variant", index);
+    RoomType room;
+    room.initialize(level);
+    return room;
+  }
+
+  template <class RoomType = Room>
+  __INLINE__ RoomType getRoom(const std::string& title) const { return getRoom<RoomType>(findLevel(title)); }
+
+  private:
+
+  // Returns the line starting at the given position (without its line break and trailing whitespace) and moves past it
+  static __INLINE__ std::string_view getLine(const std::string_view text, size_t& pos)
+  {
+    const size_t start = pos;
+    size_t end = text.find('\n', start);
+    if (end == std::string_view::npos) end = text.size();
+    pos = end + 1;
+    while (end > start && (text[end - 1] == '\r' || text[end - 1] == ' ' || text[end - 1] == '\t')) end--;
+    return text.substr(start, end - start);
+  }
+
+  // Board rows hold only level squares, at least one of them a wall
+  static __INLINE__ bool isBoardLine(const std::string_view line)
+  {
+    if (line.find('#') == std::string_view::npos) return false;
+    for (const char c : line) if (strchr(" #@+$*.-_pPbB", c) == nullptr) return false;
+    return true;
+  }
+
+  // Metadata lines start with a single word followed by a colon
+  static __INLINE__ bool isMetadataLine(const std::string_view line)
+  {
+    const size_t colon = line.find(':');
+    if (colon == 0 || colon == std::string_view::npos) return false;
+    for (size_t i = 0; i < colon; i++) if (isalnum((unsigned char)line[i]) == false) return false;
+    return true;
+  }
+
+  static __INLINE__ std::string_view trim(std::string_view text)
+  {
+    while (text.empty() == false && (text.front() == ' ' || text.front() == '\t' || text.front() == ';')) text.remove_prefix(1);
+    while (text.empty() == false && (text.back() == ' ' || text.back() == '\t')) text.remove_suffix(1);
+    return text;
+  }
+
+  __INLINE__ void buildIndex()
+  {
+    const std::string_view text(_data == nullptr ? "" : _data, _size);
+    std::string_view lastTextLine;
+    bool isInBoard = false;
+    bool isTitleFromKey = false;
+
+    for (size_t pos = 0; pos < text.size();)
+    {
+      const size_t lineOffset = pos;
+      const auto line = getLine(text, pos);
+
+      if (isBoardLine(line))
+      {
+        // Extending the current board, or starting a new one titled after the last text line seen
+        if (isInBoard) { _levels.back().size = std::min(pos, text.size()) - _levels.back().offset; continue; }
+        _levels.push_back(levelEntry_t { lineOffset, std::min(pos, text.size()) - lineOffset, std::string(trim(lastTextLine)) });
+        isInBoard = true;
+        isTitleFromKey = false;
+        lastTextLine = std::string_view();
+        continue;
+      }
+
+      isInBoard = false;
+      if (trim(line).empty()) continue;
+      if (isMetadataLine(line) == false) { lastTextLine = line; continue; }
+
+      // An explicit title after a board takes precedence over the text line before it
+      if (_levels.empty() == false && isTitleFromKey == false && line.substr(0, 6) == "Title:")
+      {
+        _levels.back().title = std::string(trim(line.substr(6)));
+        isTitleFromKey = true;
+      }
+    }
+  }
+
+  __INLINE__ void checkIndex(const size_t index) const
+  {
+    if (index >= _levels.size()) JAFFAR_THROW_LOGIC("[Error] Level index %lu is out of range (collection has %lu levels)", index, _levels.size());
+  }
+
+  const char* _data = nullptr;
+  size_t _size = 0;
+  std::vector<levelEntry_t> _levels;
+};
+
+} // namespace quickerBan
@@ -1,153 +1,225 @@
 #pragma once
 
 #include <cstdint>
+#include <cstdlib>
 #include <cstdio>
-#include <unistd.h>
-#include <jaffarCommon/string.hpp>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
 #include <jaffarCommon/serializers/base.hpp>
+#include <jaffarCommon/serializers/contiguous.hpp>
 #include <jaffarCommon/deserializers/base.hpp>
 #include <jaffarCommon/exceptions.hpp>
+#include "level.hpp"
+#include "deadlockPatternCache.hpp"
 
 namespace quickerBan {
 
-class Room
+// Types shared by all the room variants, so that pushes, move deltas and child records can be handled without knowing which
+// variant produced them
+class RoomBase
 {
   public:
 
-  enum itemType
+  // Push distance for squares from which a goal cannot be reached
+  static constexpr uint16_t unreachableDistance = Level::unreachableDistance;
+
+  enum stateFormat
+  {
+    // Row and column of the pusher and of each box, one byte each (two in wide rooms), boxes in row-major order
+    raw = 0,
+
+    // Dense index of the pusher among the reachable floor squares, followed by a box occupancy bitset over those squares
+    packed
+  };
+
+  enum heuristicType
+  {
+    // Sum of each box's push distance to its nearest goal. Cheapest, but several boxes may count the same goal
+    nearestGoal = 0,
+
+    // Cost of the minimum-cost assignment of boxes to distinct goals. An admissible lower bound on the remaining pushes
+    minimumMatching
+  };
+
+  // A box push: the box at the given cell index is pushed one square in the given direction
+  struct push_t
+  {
+    cellIndex_t boxIdx;
+    int8_t deltaY;
+    int8_t deltaX;
+  };
+
+  // Everything needed to revert a move in constant time: the previous pusher cell, the pushed box's cells (and its state slot
+  // after the push), plus the previous moved-box flag and normalized pusher cache
+  struct moveDelta_t
+  {
+    cellIndex_t pusherIdx;
+    cellIndex_t boxFromIdx;
+    cellIndex_t boxToIdx;
+    uint32_t boxToSlot;
+    cellIndex_t normalizedPusherIdx;
+    bool movedBox;
+    bool isNormalizedPusherValid;
+    bool isPush;
+  };
+
+  // Child record written by expandAll(): this header, followed by the child's saved state
+  struct childHeader_t
   {
-    wall = 0,
-    floor,
-    pusher,
-    pusher_on_goal,
-    box,
-    box_on_goal,
-    goal
+    stateHash_t hash;
+    uint8_t direction; // 0: up, 1: down, 2: left, 3: right, same order as jaffar::InputKey_t
+    bool movedBox;
+    bool isDeadlock;
   };
+};
+
+// A room being played: the shared level plus this instance's state. Levels of up to 8x8 or 16x16 squares are laid out with a
+// row stride of 8 or 16 cells, and variants for them fix that stride, the bitboard size (MaxCells) and the box capacity
+// (MaxBoxes) at compile time, so indexing uses constant shifts, bitboards and the state are held inline and whole-board loops
+// have constant bounds. A zero in any parameter means that property is taken from the level at runtime. Coord is the type of
+// the row and column values in the raw state, which bounds the room size
+template <size_t Stride, size_t MaxCells, size_t MaxBoxes, typename Coord = uint8_t>
+class BasicRoom : public RoomBase
+{
+  public:
+
+  // Bitboard type for this variant's per-instance bitboards
+  typedef BasicBitboard<MaxCells / 64> bitboard_t;
 
-  Room() = default;
-  ~Room() = default;
+  BasicRoom() = default;
+  ~BasicRoom() = default;
+
+  // Tells whether a level can be played by this variant
+  __INLINE__ static bool isCompatible(const Level& level)
+  {
+    if (Stride > 0 && level.getStride() != Stride) return false;
+    if (MaxCells > 0 && level.getCellCount() > MaxCells) return false;
+    if (MaxBoxes > 0 && level.getBoxCount() > MaxBoxes) return false;
+    if (level.getWidth() - 1 > std::numeric_limits<Coord>::max() || level.getHeight() - 1 > std::numeric_limits<Coord>::max()) return false;
+    return true;
+  }
 
   __INLINE__ void printMap() const
   {
     // Printing
-    for(uint8_t i = 0; i < _height; i++)
+    const auto pusherIdx = getIndex(_state[0], _state[1]);
+    for(uint16_t i = 0; i < _height; i++)
     {
-     for(uint8_t j = 0; j < _width; j++)
+     for(uint16_t j = 0; j < _width; j++)
      {
-       const auto tileType = _tiles[getIndex(i,j)];
-       if (tileType == itemType::wall) jaffarCommon::logger::log("#");
-       if (tileType == itemType::pusher) jaffarCommon::logger::log("@");
-       if (tileType == itemType::pusher_on_goal) jaffarCommon::logger::log("+");
-       if (tileType == itemType::box) jaffarCommon::logger::log("$");
-       if (tileType == itemType::box_on_goal) jaffarCommon::logger::log("*");
-       if (tileType == itemType::goal) jaffarCommon::logger::log(".");
-       if (tileType == itemType::floor) jaffarCommon::logger::log(" ");
+       const auto index = getIndex(i,j);
+       const bool isGoal = _level->getGoalBits().test(index);
+       if (_level->getWallBits().test(index)) jaffarCommon::logger::log("#");
+       else if (index == pusherIdx) jaffarCommon::logger::log(isGoal ? "+" : "@");
+       else if (_boxBits.test(index)) jaffarCommon::logger::log(isGoal ? "*" : "$");
+       else if (isGoal) jaffarCommon::logger::log(".");
+       else jaffarCommon::logger::log(" ");
      } 
      jaffarCommon::logger::log("\n");
     }
   }
 
-  __INLINE__ void parse(const std::string& roomString)
+  // Sets this room to the start of the given level. The level is only referenced, so many rooms can share it; all that is
+  // allocated here is this room's own state and scratch storage
+  __INLINE__ void initialize(const std::shared_ptr<const Level>& level)
   {
-    const auto rowSequence = jaffarCommon::string::split(roomString, '\n');
-
-    // Getting room size
-    _height = rowSequence.size();
-    for (uint8_t i = 0; i < _height; i++)
-    {
-        const auto& row = rowSequence[i];
-        if (row.size() > _width) _width = (uint8_t) row.size();
-    }
-
-    // Allocating static and dynamic room information
-    long pageSize = sysconf (_SC_PAGESIZE);
-    _background = (uint8_t*)aligned_alloc(pageSize, _height * _width * sizeof(uint8_t));
-    _tiles = (uint8_t*)aligned_alloc(pageSize, _height * _width * sizeof(uint8_t));
-    _tmp = (uint8_t*)aligned_alloc(pageSize, _height * _width * sizeof(uint8_t));
-
-    // Clearing room 
-    for (uint8_t i = 0; i < _height; i++)
-     for (uint8_t j = 0; j < _width; j++)
-      _tiles[getIndex(i,j)] = itemType::floor;
-    
-    // Parsing from input
-    _boxCount = 0;
-    _goalCount = 0;
-    for (uint8_t i = 0; i < _height; i++)
+    if (isCompatible(*level) == false) JAFFAR_THROW_LOGIC("Level of %lu cells and %lu boxes does not fit this room variant", level->getCellCount(), level->getBoxCount());
+    if (_isPushMacroEnabled && level->isPushMacroEnabled() == false) JAFFAR_THROW_LOGIC("Push macros are enabled but the level was built without them");
+
+    _level = level;
+    _stride = _level->getStride();
+    _width = _level->getWidth();
+    _height = _level->getHeight();
+    _boxCount = _level->getBoxCount();
+    _goalCount = _level->getGoalCount();
+    _stateSize = 2 * (1 + _boxCount) * sizeof(Coord);
+    if constexpr (MaxBoxes == 0) _state.resize(2 * (1 + _boxCount));
+    _state[0] = getRow(_level->getInitialPusher());
+    _state[1] = getColumn(_level->getInitialPusher());
+    for (size_t i = 0; i < _boxCount; i++)
     {
-        const auto& row = rowSequence[i];
-        for (uint8_t j = 0; j < row.size(); j++)
-        {
-            if (row[j] == ' ' || row[j] == '-' || row[j] == '_') _tiles[getIndex(i,j)] = itemType::floor;
-            if (row[j] == '.') { _tiles[getIndex(i,j)] = itemType::goal; _goalCount++; }
-            if (row[j] == '*' || row[j] == 'B') { _tiles[getIndex(i,j)] = itemType::box_on_goal; _boxCount++; _goalCount++; }
-            if (row[j] == 'b' || row[j] == '$') { _tiles[getIndex(i,j)] = itemType::box; _boxCount++;  }
-            if (row[j] == 'P' || row[j] == '+') { _tiles[getIndex(i,j)] = itemType::pusher_on_goal; _goalCount++; }
-            if (row[j] == 'p' || row[j] == '@') _tiles[getIndex(i,j)] = itemType::pusher;
-            if (row[j] == '#') _tiles[getIndex(i,j)] = itemType::wall;
-        }
+      _state[(i+1) * 2 + 0] = getRow(_level->getInitialBoxes()[i]);
+      _state[(i+1) * 2 + 1] = getColumn(_level->getInitialBoxes()[i]);
     }
 
-    // Sanity check: boxes = goals
-    if (_boxCount != _goalCount) JAFFAR_THROW_LOGIC("Number of boxes (%lu) is not equal to goals (%lu)", _boxCount, _goalCount);
+    // Allocating per-instance bitboards and buffers
+    const size_t cellCount = _level->getCellCount();
+    _boxBits.resize(cellCount);
+    _freezeBits.resize(cellCount);
+    _floodBits.resize(cellCount);
+    _reachBits.resize(cellCount);
+    _blockedBits.resize(cellCount);
+    _corralBits.resize(cellCount);
+    _candidateBits.resize(cellCount);
+    _savedBoxBits.resize(cellCount);
+    _pusherReachBits.resize(cellCount);
+    _pathVisitedBits.resize(cellCount);
+    _pathDirections.resize(cellCount);
+    _packedState.resize(_level->getPackedStateSize());
+    _freezeStack.clear();
+    _corralCache.clear();
+
+    // Updating derived state
+    updateBoxBits();
+    updateStateHash();
+    _isMatchingValid = false;
+    _isNormalizedPusherValid = false;
+    _isPusherReachValid = false;
+  }
 
-    // Allocating state space
-    _stateSize = 2 * sizeof(uint8_t) * (1 + _boxCount);
-    _state = (uint8_t*)aligned_alloc(pageSize, _stateSize);
+  // Builds a new level from the given room string and sets this room to its start
+  __INLINE__ void parse(const std::string& roomString) { initialize(std::make_shared<const Level>(roomString)); }
 
-    // Building background
-    for (uint8_t i = 0; i < _height; i++)
-    for (uint8_t j = 0; j < _width; j++)
-    {
-       if (_tiles[getIndex(i,j)] == itemType::floor) _background[getIndex(i,j)] = itemType::floor;
-       if (_tiles[getIndex(i,j)] == itemType::goal) _background[getIndex(i,j)] = itemType::goal;
-       if (_tiles[getIndex(i,j)] == itemType::pusher) _background[getIndex(i,j)] = itemType::floor;
-       if (_tiles[getIndex(i,j)] == itemType::pusher_on_goal) _background[getIndex(i,j)] = itemType::goal;
-       if (_tiles[getIndex(i,j)] == itemType::box) _background[getIndex(i,j)] = itemType::floor;
-       if (_tiles[getIndex(i,j)] == itemType::box_on_goal) _background[getIndex(i,j)] = itemType::goal;
-    }
-
-    // Updating state
-    updateState();
-  }
+  __INLINE__ const std::shared_ptr<const Level>& getLevel() const { return _level; }
 
-  __INLINE__ uint8_t getBoxCount() const { return _boxCount; }
+  __INLINE__ size_t getBoxCount() const { return _boxCount; }
   __INLINE__ bool canMoveUp() const { return canMove(-1, 0); }
   __INLINE__ bool canMoveDown() const { return canMove(1, 0); }
   __INLINE__ bool canMoveLeft() const { return canMove(0, -1); }
   __INLINE__ bool canMoveRight() const { return canMove(0, 1); }
 
-  // Returns true if deadlock, false if ok
-  __INLINE__ bool move(const int8_t deltaY, const int8_t deltaX) 
+  // Returns true if deadlock, false if ok. If a delta is given, it is filled so that undo() can revert this move
+  __INLINE__ bool move(const int8_t deltaY, const int8_t deltaX, moveDelta_t* delta = nullptr)
   {
     // Locating pusher's target destination
     const auto pusherPosY = _state[0];
     const auto pusherPosX = _state[1];
-    const auto pusherIdx = getIndex(pusherPosY, pusherPosX);
-
-    // Removing current pusher from map
-    _tiles[pusherIdx] = _background[pusherIdx];
 
     // Getting destination index
     const auto destPosY = pusherPosY + deltaY;
     const auto destPosX = pusherPosX + deltaX;
     const auto index1 = getIndex(destPosY, destPosX);
 
+    // Recording what is needed to revert this move
+    if (delta != nullptr)
+    {
+      delta->pusherIdx = getIndex(pusherPosY, pusherPosX);
+      delta->movedBox = _movedBox;
+      delta->isNormalizedPusherValid = _isNormalizedPusherValid;
+      delta->normalizedPusherIdx = _normalizedPusherIdx;
+      delta->isPush = false;
+    }
+
     // Reset moved box flag
     _movedBox = false;
 
     // Flag to report deadlock
     bool isDeadlock = false;
 
-    // Checking if there is a box there already
-    const auto tile1Type = _tiles[index1];
-
     // Move the pusher now
-    _tiles[index1] = itemType::pusher;
+    _stateHash ^= _level->getPusherKey(getIndex(pusherPosY, pusherPosX)) ^ _level->getPusherKey(index1);
+    _state[0] = destPosY;
+    _state[1] = destPosX;
 
     // Now handle the box push, if one
-    if (tile1Type == itemType::box || tile1Type == itemType::box_on_goal)
+    if (_boxBits.test(index1))
     {
        // Setting flag
        _movedBox = true;
@@ -156,168 +228,687 @@ class Room
        const auto dest2PosY = destPosY + deltaY;
        const auto dest2PosX = destPosX + deltaX;
        const auto index2 = getIndex(dest2PosY, dest2PosX);
+       _boxBits.clear(index1);
+       _boxBits.set(index2);
+       _stateHash ^= _level->getBoxKey(index1) ^ _level->getBoxKey(index2);
+       _isNormalizedPusherValid = false;
+       _isPusherReachValid = false;
 
-      // Check if box is moving to a goal
-      const bool isBoxOnGoal = _background[index2] == itemType::goal;
+       _boxesOnGoal += _level->getGoalBits().test(index2) - _level->getGoalBits().test(index1);
 
        // Checking deadlock
-       if (isBoxOnGoal == false) isDeadlock = checkBoxDeadlock(dest2PosY, dest2PosX);
+       isDeadlock = checkBoxDeadlock(index2);
 
-       // Moving box
-       if (isBoxOnGoal) _tiles[index2] = itemType::box_on_goal;
-       else _tiles[index2] = itemType::box;
-    }
+       // Updating the moved box's entry in the state
+       const auto fromSlot = findBoxSlot(index1);
+       const auto toSlot = relocateBox(fromSlot, index2);
 
-    // Updating state
-    updateState();
+       // Keeping the box-to-goal matching aligned with the new box order, if one is being maintained
+       if (_isMatchingValid) onMatchedBoxMoved(fromSlot, toSlot);
+
+       if (delta != nullptr)
+       {
+         delta->boxFromIdx = index1;
+         delta->boxToIdx = index2;
+         delta->boxToSlot = toSlot;
+         delta->isPush = true;
+       }
+    }
 
     return isDeadlock;
   }
+
+  // Reverts a move in constant time, without touching the rest of the board. Deltas must be undone in the reverse order of the
+  // moves that produced them
+  __INLINE__ void undo(const moveDelta_t& delta)
+  {
+    if (delta.isPush)
+    {
+      _boxBits.clear(delta.boxToIdx);
+      _boxBits.set(delta.boxFromIdx);
+      _stateHash ^= _level->getBoxKey(delta.boxToIdx) ^ _level->getBoxKey(delta.boxFromIdx);
+      _boxesOnGoal += _level->getGoalBits().test(delta.boxFromIdx) - _level->getGoalBits().test(delta.boxToIdx);
+      const auto fromSlot = relocateBox(delta.boxToSlot, delta.boxFromIdx);
+      if (_isMatchingValid) onMatchedBoxMoved(delta.boxToSlot, fromSlot);
+    }
+
+    _stateHash ^= _level->getPusherKey(getIndex(_state[0], _state[1])) ^ _level->getPusherKey(delta.pusherIdx);
+    _state[0] = getRow(delta.pusherIdx);
+    _state[1] = getColumn(delta.pusherIdx);
+    _movedBox = delta.movedBox;
+    _isNormalizedPusherValid = delta.isNormalizedPusherValid;
+    _normalizedPusherIdx = delta.normalizedPusherIdx;
+
+    // The reach area is not kept in the delta, so it has to be filled again if a box was moved back
+    if (delta.isPush) _isPusherReachValid = false;
+  }
+
+  // Size of each child record, padded so that consecutive headers stay aligned
+  __INLINE__ size_t getChildRecordSize() const { return (sizeof(childHeader_t) + getStateSize() + alignof(childHeader_t) - 1) & ~(alignof(childHeader_t) - 1); }
+
+  // Generates every child of the current state in one pass, writing their records one after the other into the given buffer,
+  // which must hold at least four records. Each child is produced by an in-place move and reverted right after, so the current
+  // state is left untouched and nothing is allocated or rebuilt. Returns the number of children written
+  __INLINE__ size_t expandAll(uint8_t* buffer)
+  {
+    const int8_t directions[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+    const cellIndex_t pusherIdx = getIndex(_state[0], _state[1]);
+    const size_t recordSize = getChildRecordSize();
+    const size_t stateSize = getStateSize();
+
+    size_t childCount = 0;
+    for (uint8_t d = 0; d < 4; d++)
+    {
+      // Checking the move is legal
+      const int offset = directions[d][0] * (int)getStride() + directions[d][1];
+      const cellIndex_t nextIdx = pusherIdx + offset;
+      if (_level->getWallBits().test(nextIdx)) continue;
+      if (_boxBits.test(nextIdx) && (_level->getWallBits().test(nextIdx + offset) || _boxBits.test(nextIdx + offset))) continue;
+
+      // Applying the move and storing the child
+      uint8_t* record = &buffer[childCount * recordSize];
+      auto header = (childHeader_t*)record;
+      moveDelta_t delta;
+      header->isDeadlock = move(directions[d][0], directions[d][1], &delta);
+      header->movedBox = _movedBox;
+      header->direction = d;
+      header->hash = getStateHash();
+      jaffarCommon::serializer::Contiguous serializer(&record[sizeof(childHeader_t)], stateSize);
+      saveState(serializer);
+
+      undo(delta);
+      childCount++;
+    }
+
+    return childCount;
+  }
   
-  // Checking if the recently moved box that is not in a goal position has provoked a deadlock
-  __INLINE__ bool checkBoxDeadlock(const uint8_t y, const uint8_t x)
-  {
-    // Check 1: If the box is stuck between two walls
-    //  x#
-    //  #
-    if (_background[getIndex(y+1, x)] == itemType::wall && _background[getIndex(y, x+1)] == itemType::wall) return true;
-
-    // #x
-    //  #
-    if (_background[getIndex(y+1, x)] == itemType::wall && _background[getIndex(y, x-1)] == itemType::wall) return true;
-
-    // # 
-    // x#
-    if (_background[getIndex(y-1, x)] == itemType::wall && _background[getIndex(y, x+1)] == itemType::wall) return true;
-
-    //  #
-    // #x
-    if (_background[getIndex(y-1, x)] == itemType::wall && _background[getIndex(y, x-1)] == itemType::wall) return true;
-
-    // Check 2: If the box is bunched up in a square
-    // x$
-    // $$
-    if (
-            (_tiles[getIndex(y+1, x+0)] == itemType::box || _tiles[getIndex(y+1, x+0)] == itemType::box_on_goal || _tiles[getIndex(y+1, x+0)] == itemType::wall)
-         && (_tiles[getIndex(y+0, x+1)] == itemType::box || _tiles[getIndex(y+0, x+1)] == itemType::box_on_goal || _tiles[getIndex(y+0, x+1)] == itemType::wall)
-         && (_tiles[getIndex(y+1, x+1)] == itemType::box || _tiles[getIndex(y+1, x+1)] == itemType::box_on_goal || _tiles[getIndex(y+1, x+1)] == itemType::wall)
-    ) return true;
-
-    // $x
-    // $$
-    if (
-         (_tiles[getIndex(y+1, x+0)] == itemType::box || _tiles[getIndex(y+1, x+0)] == itemType::box_on_goal || _tiles[getIndex(y+1, x+0)] == itemType::wall)
-      && (_tiles[getIndex(y+0, x-1)] == itemType::box || _tiles[getIndex(y+0, x-1)] == itemType::box_on_goal || _tiles[getIndex(y+0, x-1)] == itemType::wall)
-      && (_tiles[getIndex(y+1, x-1)] == itemType::box || _tiles[getIndex(y+1, x-1)] == itemType::box_on_goal || _tiles[getIndex(y+1, x-1)] == itemType::wall)
-        ) return true;
-
-    // $$
-    // x$
-    if (
-           (_tiles[getIndex(y-1, x+0)] == itemType::box || _tiles[getIndex(y-1, x+0)] == itemType::box_on_goal || _tiles[getIndex(y-1, x+0)] == itemType::wall)
-        && (_tiles[getIndex(y+0, x+1)] == itemType::box || _tiles[getIndex(y+0, x+1)] == itemType::box_on_goal || _tiles[getIndex(y+0, x+1)] == itemType::wall)
-        && (_tiles[getIndex(y-1, x+1)] == itemType::box || _tiles[getIndex(y-1, x+1)] == itemType::box_on_goal || _tiles[getIndex(y-1, x+1)] == itemType::wall)
-     ) return true;
-
-    // $$
-    // $x
-    if (
-           (_tiles[getIndex(y-1, x+0)] == itemType::box || _tiles[getIndex(y-1, x+0)] == itemType::box_on_goal || _tiles[getIndex(y-1, x+0)] == itemType::wall)
-        && (_tiles[getIndex(y+0, x-1)] == itemType::box || _tiles[getIndex(y+0, x-1)] == itemType::box_on_goal || _tiles[getIndex(y+0, x-1)] == itemType::wall)
-        && (_tiles[getIndex(y-1, x-1)] == itemType::box || _tiles[getIndex(y-1, x-1)] == itemType::box_on_goal || _tiles[getIndex(y-1, x-1)] == itemType::wall)
-       ) return true;
+  // Checking if the recently moved box has provoked a deadlock
+  __INLINE__ bool checkBoxDeadlock(const cellIndex_t index)
+  {
+    // Check 1: If the box is on a dead square, from which it can never reach a goal. This includes boxes stuck between two walls
+    //  x#     #x     #      #
+    //  #       #     x#    #x
+    if (_level->getDeadBits().test(index)) return true;
+
+    // Check 2: If the box is off goal and bunched up in a square. This is a cheap special case of check 3
+    // x$     $x     $$     $$
+    // $$     $$     x$     $x
+    // The 3x3 neighbourhood is read as three 3-bit rows of blocked (wall or box) cells, with the box itself in the middle bit
+    if (_level->getGoalBits().test(index) == false)
+    {
+      const auto top = getBlockedBits(index - getStride() - 1);
+      const auto mid = getBlockedBits(index - 1);
+      const auto bot = getBlockedBits(index + getStride() - 1);
+      for (const uint64_t pair : { 0b011ull, 0b110ull })
+       if ((mid & pair) == pair && ((top & pair) == pair || (bot & pair) == pair)) return true;
+    }
+
+    // Check 3: If the box is frozen together with at least one box that is off goal
+    //  $$     #$      $
+    // #  #     $$    $$#
+    if (_deadlockPatternCache != nullptr) return checkCachedFreezeDeadlock(index);
+    return checkFreezeDeadlock(index);
+  }
+
+  // Same as checkFreezeDeadlock(), but looking the box's surroundings up in the deadlock pattern cache first. Verdicts are only
+  // cached if the analysis did not look past the window, and windows reaching past the board are not looked up at all
+  __INLINE__ bool checkCachedFreezeDeadlock(const cellIndex_t index)
+  {
+    constexpr int size = DeadlockPatternCache::windowSize;
+    constexpr int radius = size / 2;
+    const int y = getRow(index);
+    const int x = getColumn(index);
+    if (y < radius || x < radius || y + radius >= _height || x + radius >= _width) return checkFreezeDeadlock(index);
+
+    // Reading the window one row at a time
+    uint64_t walls[size], boxes[size], goals[size], deads[size];
+    for (int i = 0; i < size; i++)
+    {
+      const cellIndex_t rowStart = index + (i - radius) * (int)getStride() - radius;
+      walls[i] = _level->getWallBits().getBits(rowStart, size);
+      boxes[i] = _boxBits.getBits(rowStart, size);
+      goals[i] = _level->getGoalBits().getBits(rowStart, size);
+      deads[i] = _level->getDeadBits().getBits(rowStart, size);
+    }
+
+    const auto key = DeadlockPatternCache::getKey(walls, boxes, goals, deads);
+    const auto verdict = _deadlockPatternCache->lookup(key);
+    if (verdict != DeadlockPatternCache::unknown) return verdict == DeadlockPatternCache::deadlock;
+
+    _freezeCenter = index;
+    _isFreezeLocal = true;
+    const bool isDeadlock = checkFreezeDeadlock(index);
+    if (_isFreezeLocal) _deadlockPatternCache->insert(key, isDeadlock);
+    return isDeadlock;
+  }
+
+  // Sets the deadlock pattern cache to consult, which may be shared with other rooms. Null disables it
+  __INLINE__ void setDeadlockPatternCache(const std::shared_ptr<DeadlockPatternCache>& cache) { _deadlockPatternCache = cache; }
+
+  // Checks whether the box at the given index can no longer be pushed along either axis and, if so, whether itself or any of the
+  // boxes freezing it is off goal
+  __INLINE__ bool checkFreezeDeadlock(const cellIndex_t index)
+  {
+    const bool isFrozen = isBoxFrozen(index);
+
+    // All boxes still marked are frozen, so it is a deadlock if any of them is not on a goal
+    bool isDeadlock = false;
+    for (const auto boxIdx : _freezeStack)
+    {
+      if (isFrozen && _level->getGoalBits().test(boxIdx) == false) isDeadlock = true;
+      _freezeBits.clear(boxIdx);
+    }
+    _freezeStack.clear();
+
+    return isDeadlock;
+  }
+
+  // A box is frozen if it is blocked both horizontally and vertically. While a box is being evaluated it is marked and treated as
+  // a wall by the boxes around it, which breaks cycles. If it turns out not to be frozen, its mark and those of any box whose
+  // freeze depended on it are rolled back
+  inline bool isBoxFrozen(const cellIndex_t index)
+  {
+    const size_t stackPos = _freezeStack.size();
+    _freezeBits.set(index);
+    _freezeStack.push_back(index);
+
+    // Tracking whether the analysis stays close enough to the pushed box for its verdict to be cached
+    if (_deadlockPatternCache != nullptr)
+    {
+      const int dy = (int)getRow(index) - (int)getRow(_freezeCenter);
+      const int dx = (int)getColumn(index) - (int)getColumn(_freezeCenter);
+      if (std::abs(dy) > DeadlockPatternCache::localRadius || std::abs(dx) > DeadlockPatternCache::localRadius) _isFreezeLocal = false;
+    }
+
+    if (isBoxBlocked(index, 1) && isBoxBlocked(index, getStride())) return true;
+
+    for (size_t i = stackPos; i < _freezeStack.size(); i++) _freezeBits.clear(_freezeStack[i]);
+    _freezeStack.resize(stackPos);
+    return false;
+  }
+
+  // A box is blocked along an axis if it has a wall (or a box assumed frozen) on either side, dead squares on both sides, or a
+  // frozen box on either side
+  inline bool isBoxBlocked(const cellIndex_t index, const cellIndex_t offset)
+  {
+    const cellIndex_t before = index - offset;
+    const cellIndex_t after = index + offset;
+
+    if (_level->getWallBits().test(before) || _level->getWallBits().test(after)) return true;
+    if (_freezeBits.test(before) || _freezeBits.test(after)) return true;
+    if (_level->getDeadBits().test(before) && _level->getDeadBits().test(after)) return true;
+    if (_boxBits.test(before) && isBoxFrozen(before)) return true;
+    if (_boxBits.test(after) && isBoxFrozen(after)) return true;
 
     return false;
   }
 
+  __INLINE__ bool isDeadSquare(const uint16_t y, const uint16_t x) const { return _level->getDeadBits().test(getIndex(y, x)); }
   __INLINE__ bool getMovedBox() const { return _movedBox; }
-  __INLINE__ size_t getBoxesOnGoal() const
-   {
-    size_t boxesOnGoal = 0;
-    for(uint8_t i = 0; i < _boxCount; i++)
+
+  // Returns the cells the pusher can walk to without pushing any box. The area only changes when a box moves, so it is filled
+  // once per box configuration and shared by the push and pull generators, the corral check and the normalized pusher position
+  __INLINE__ const bitboard_t& getPusherReach() const
+  {
+    if (_isPusherReachValid == false)
     {
-      auto boxPosY = _state[(i+1) * 2 + 0];
-      auto boxPosX = _state[(i+1) * 2 + 1];
-      auto index = getIndex(boxPosY, boxPosX);
-      if (_background[index] == itemType::goal) boxesOnGoal++;
+      _blockedBits.copyFrom(_level->getWallBits());
+      _blockedBits.orWith(_boxBits);
+      floodFill(_pusherReachBits, getIndex(_state[0], _state[1]), _blockedBits);
+      _isPusherReachValid = true;
     }
-    return boxesOnGoal;
-   }
+
+    return _pusherReachBits;
+  }
+
+  // Enumerates every legal push: for each box and direction, the square behind the box must be reachable by the pusher and the
+  // square ahead must be free. Pushes onto dead squares are included; applyPush() reports them as deadlocks
+  __INLINE__ void getPushes(std::vector<push_t>& pushes)
+  {
+    pushes.clear();
+    const auto& reach = getPusherReach();
+
+    const int8_t directions[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+    for (size_t i = 0; i < _boxCount; i++)
+    {
+      const cellIndex_t boxIdx = getIndex(_state[(i+1) * 2 + 0], _state[(i+1) * 2 + 1]);
+      for (const auto& direction : directions)
+      {
+        const int offset = direction[0] * (int)getStride() + direction[1];
+        if (reach.test(boxIdx - offset) == false) continue;
+        if (_level->getWallBits().test(boxIdx + offset) || _boxBits.test(boxIdx + offset)) continue;
+        pushes.push_back(push_t { boxIdx, direction[0], direction[1] });
+      }
+    }
+  }
+
+  // Walks the pusher to the square behind the box and performs the push, followed by its macro if enabled. Returns true if the
+  // push provoked a deadlock. If a delta is given, undo() reverts the walk, the push and the macro. The macro moves actually made
+  // (it stops at the first deadlock) are recorded for getLastPushCount() and getLastMacroInputString()
+  __INLINE__ bool applyPush(const push_t& push, moveDelta_t* delta = nullptr)
+  {
+    const cellIndex_t pusherIdx = getIndex(_state[0], _state[1]);
+    const cellIndex_t behindIdx = push.boxIdx - (push.deltaY * (int)getStride() + push.deltaX);
+
+    // Walking does not move any box, so the normalized pusher position remains valid
+    _stateHash ^= _level->getPusherKey(pusherIdx) ^ _level->getPusherKey(behindIdx);
+    _state[0] = getRow(behindIdx);
+    _state[1] = getColumn(behindIdx);
+
+    // Working out the macro that follows the push, if enabled, while the board is still as before it
+    if (_isPushMacroEnabled) getPushMacro(push, _macroSteps);
+
+    bool isDeadlock = move(push.deltaY, push.deltaX, delta);
+    if (delta != nullptr) delta->pusherIdx = pusherIdx;
+    if (_isPushMacroEnabled == false || _macroSteps.empty()) return isDeadlock;
+
+    // Performing the macro. It only moves the pushed box, so the delta of the first move is extended to its final square
+    cellIndex_t boxIdx = push.boxIdx + push.deltaY * (int)getStride() + push.deltaX;
+    size_t stepCount = 0;
+    for (; stepCount < _macroSteps.size() && isDeadlock == false; stepCount++)
+    {
+      const auto& step = _macroSteps[stepCount];
+      if (step.isPush) boxIdx += step.deltaY * (int)getStride() + step.deltaX;
+      isDeadlock = move(step.deltaY, step.deltaX);
+    }
+    _macroSteps.resize(stepCount);
+
+    if (delta != nullptr)
+    {
+      delta->boxToIdx = boxIdx;
+      delta->boxToSlot = findBoxSlot(boxIdx);
+    }
+    return isDeadlock;
+  }
+
+  // Push macros make applyPush() carry on after a push with the moves that are safe to make right away: pushing the box further
+  // along a tunnel, and packing it into a goal room it has just been pushed into (see Level::goalRoom_t). Disabled by default, and
+  // only available if the level was built with them
+  __INLINE__ void setPushMacrosEnabled(const bool isEnabled)
+  {
+    if (isEnabled && _level != nullptr && _level->isPushMacroEnabled() == false) JAFFAR_THROW_LOGIC("Push macros are enabled but the level was built without them");
+    _isPushMacroEnabled = isEnabled;
+    _macroSteps.clear();
+  }
+  __INLINE__ bool isPushMacroEnabled() const { return _isPushMacroEnabled; }
+
+  // Number of pushes made by the last applyPush(): one, plus those of its macro
+  __INLINE__ size_t getLastPushCount() const
+  {
+    size_t pushCount = 1;
+    for (const auto& step : _macroSteps) pushCount += step.isPush;
+    return pushCount;
+  }
+
+  // Appends to the given string the LURD inputs of the macro moves made by the last applyPush(), if any
+  __INLINE__ void getLastMacroInputString(std::string& inputString) const
+  {
+    for (const auto& step : _macroSteps) inputString.push_back(getDirectionInput(step.deltaY, step.deltaX, step.isPush));
+  }
+
+  // Fills the given vector with the moves of the macro following the push, which is yet to be applied. Tunnel pushes go on while
+  // both the box and the pusher are in a tunnel along the push, the box is off goal, and the square ahead is free and not dead
+  __INLINE__ void getPushMacro(const push_t& push, std::vector<Level::macroStep_t>& steps) const
+  {
+    steps.clear();
+    const int offset = push.deltaY * (int)getStride() + push.deltaX;
+    const auto& tunnelBits = _level->getTunnelBits(push.deltaY != 0);
+    cellIndex_t boxIdx = push.boxIdx + offset;
+
+    while (true)
+    {
+      // Packing the box if it just entered a goal room whose already filled goals are exactly the first ones in its packing order
+      if (_level->getGoalRoomEntranceBits().test(boxIdx))
+      {
+        const auto& goalRoom = _level->getGoalRoom(boxIdx);
+        const size_t filledCount = _boxBits.andPopcount(goalRoom.cells);
+        if (goalRoom.deltaY == push.deltaY && goalRoom.deltaX == push.deltaX && filledCount < goalRoom.macros.size() && _boxBits.andPopcount(goalRoom.filledGoals[filledCount]) == filledCount)
+          steps.insert(steps.end(), goalRoom.macros[filledCount].begin(), goalRoom.macros[filledCount].end());
+        return;
+      }
+
+      const cellIndex_t aheadIdx = boxIdx + offset;
+      if (_level->getGoalBits().test(boxIdx) || tunnelBits.test(boxIdx) == false || tunnelBits.test(boxIdx - offset) == false) return;
+      if (_level->getWallBits().test(aheadIdx) || _boxBits.test(aheadIdx) || _level->getDeadBits().test(aheadIdx)) return;
+
+      steps.push_back(Level::macroStep_t { push.deltaY, push.deltaX, true });
+      boxIdx = aheadIdx;
+    }
+  }
+
+  // Expands a push into the LURD inputs that perform it from the current state: the shortest walk to the square behind the box
+  // in lowercase, followed by the push itself in uppercase. Must be called before the push is applied. With push macros, the
+  // inputs of the macro moves that follow are given by getLastMacroInputString() once the push is applied
+  __INLINE__ void getPushInputString(const push_t& push, std::string& inputString) const
+  {
+    const cellIndex_t behindIdx = push.boxIdx - (push.deltaY * (int)getStride() + push.deltaX);
+    getWalkInputString(behindIdx, inputString);
+    inputString.push_back(getDirectionInput(push.deltaY, push.deltaX, true));
+  }
+
+  // Appends to the given string the shortest walk (lowercase LURD) from the pusher to the given square, which must be reachable
+  __INLINE__ void getWalkInputString(const cellIndex_t targetIdx, std::string& inputString) const
+  {
+    const int8_t directions[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+    const cellIndex_t pusherIdx = getIndex(_state[0], _state[1]);
+
+    // Breadth-first search from the pusher, recording the direction used to enter each square
+    _pathVisitedBits.reset();
+    _pathVisitedBits.set(pusherIdx);
+    _pathQueue.clear();
+    _pathQueue.push_back(pusherIdx);
+    for (size_t q = 0; q < _pathQueue.size() && _pathVisitedBits.test(targetIdx) == false; q++)
+     for (uint8_t d = 0; d < 4; d++)
+     {
+       const cellIndex_t nextIdx = _pathQueue[q] + directions[d][0] * (int)getStride() + directions[d][1];
+       if (_pathVisitedBits.test(nextIdx) || _level->getWallBits().test(nextIdx) || _boxBits.test(nextIdx)) continue;
+       _pathVisitedBits.set(nextIdx);
+       _pathDirections[nextIdx] = d;
+       _pathQueue.push_back(nextIdx);
+     }
+
+    if (_pathVisitedBits.test(targetIdx) == false) JAFFAR_THROW_LOGIC("Target square %u is not reachable by the pusher", targetIdx);
+
+    // Walking back from the target to get the path in reverse
+    const size_t pathStart = inputString.size();
+    for (cellIndex_t idx = targetIdx; idx != pusherIdx;)
+    {
+      const auto& direction = directions[_pathDirections[idx]];
+      inputString.push_back(getDirectionInput(direction[0], direction[1], false));
+      idx -= direction[0] * (int)getStride() + direction[1];
+    }
+    std::reverse(inputString.begin() + pathStart, inputString.end());
+  }
+
+  // Gets the top-left square of each area the pusher could be standing in once every box is on a goal. A forward search may end
+  // in any of them, so each one gives a distinct solved state from which a backward (pull) search can start
+  __INLINE__ void getSolvedPusherStarts(std::vector<cellIndex_t>& starts)
+  {
+    starts.clear();
+    _blockedBits.copyFrom(_level->getWallBits());
+    _blockedBits.orWith(_level->getGoalBits());
+    _candidateBits.copyFrom(_level->getFloorBits());
+    _candidateBits.andNotWith(_level->getGoalBits());
+    while (_candidateBits.any())
+    {
+      starts.push_back(_candidateBits.findFirst());
+      floodFill(_reachBits, starts.back(), _blockedBits);
+      _candidateBits.andNotWith(_reachBits);
+    }
+  }
+
+  // Sets the solved state, with every box on a goal and the pusher on the given free square, as the start of a backward search
+  __INLINE__ void setSolvedState(const cellIndex_t pusherIdx)
+  {
+    clearBoxBits();
+
+    // Goals are listed in row-major order, so boxes come out already sorted
+    const auto& goals = _level->getGoals();
+    for (size_t i = 0; i < _boxCount; i++)
+    {
+      _state[(i+1) * 2 + 0] = getRow(goals[i]);
+      _state[(i+1) * 2 + 1] = getColumn(goals[i]);
+    }
+    _state[0] = getRow(pusherIdx);
+    _state[1] = getColumn(pusherIdx);
+
+    updateBoxBits();
+    updateStateHash();
+    _movedBox = false;
+    _isMatchingValid = false;
+    _isNormalizedPusherValid = false;
+    _isPusherReachValid = false;
+  }
+
+  // Enumerates every legal pull, with the box moving one square in the given direction. The square the box moves into must be
+  // reachable by the pusher, and the one beyond it, where the pusher ends up, must be free. States reached by pulls from a
+  // solved state are ordinary states: they hash (getStateHash()) and serialize exactly like forward ones, so both searches can
+  // look each other's states up. Pulls need no deadlock checks, since every such state can be pushed back to the solution
+  __INLINE__ void getPulls(std::vector<push_t>& pulls)
+  {
+    pulls.clear();
+    const auto& reach = getPusherReach();
+
+    const int8_t directions[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+    for (size_t i = 0; i < _boxCount; i++)
+    {
+      const cellIndex_t boxIdx = getIndex(_state[(i+1) * 2 + 0], _state[(i+1) * 2 + 1]);
+      for (const auto& direction : directions)
+      {
+        const int offset = direction[0] * (int)getStride() + direction[1];
+        if (reach.test(boxIdx + offset) == false) continue;
+        if (_level->getWallBits().test(boxIdx + 2 * offset) || _boxBits.test(boxIdx + 2 * offset)) continue;
+        pulls.push_back(push_t { boxIdx, direction[0], direction[1] });
+      }
+    }
+  }
+
+  // Walks the pusher to the square the box moves into and pulls the box, leaving the pusher one square further
+  __INLINE__ void applyPull(const push_t& pull)
+  {
+    const int offset = pull.deltaY * (int)getStride() + pull.deltaX;
+    const cellIndex_t boxToIdx = pull.boxIdx + offset;
+    const cellIndex_t pusherToIdx = boxToIdx + offset;
+
+    // Moving the pusher
+    _stateHash ^= _level->getPusherKey(getIndex(_state[0], _state[1])) ^ _level->getPusherKey(pusherToIdx);
+    _state[0] = getRow(pusherToIdx);
+    _state[1] = getColumn(pusherToIdx);
+
+    // Moving the box
+    _movedBox = true;
+    _boxBits.clear(pull.boxIdx);
+    _boxBits.set(boxToIdx);
+    _stateHash ^= _level->getBoxKey(pull.boxIdx) ^ _level->getBoxKey(boxToIdx);
+    _boxesOnGoal += _level->getGoalBits().test(boxToIdx) - _level->getGoalBits().test(pull.boxIdx);
+    _isNormalizedPusherValid = false;
+    _isPusherReachValid = false;
+
+    // Updating the moved box's entry in the state and the matching
+    const auto fromSlot = findBoxSlot(pull.boxIdx);
+    const auto toSlot = relocateBox(fromSlot, boxToIdx);
+    if (_isMatchingValid) onMatchedBoxMoved(fromSlot, toSlot);
+  }
+
+  // Returns the forward push that reverts the given pull, which is how a backward search path is replayed forwards
+  __INLINE__ push_t getReversePush(const push_t& pull) const
+  {
+    const cellIndex_t boxToIdx = pull.boxIdx + pull.deltaY * (int)getStride() + pull.deltaX;
+    return push_t { boxToIdx, (int8_t)-pull.deltaY, (int8_t)-pull.deltaX };
+  }
+
+  __INLINE__ void setCorralSearchLimit(const size_t limit) { _corralSearchLimit = limit; }
+
+  // Checks whether any corral (a region of free squares the pusher cannot reach) is deadlocked. For each corral, all boxes other
+  // than those bordering it are removed and a bounded search over pushes of the remaining ones looks for a way to either let the
+  // pusher into the corral or get all of them onto goals. Removing boxes only makes this easier, so if neither is possible the
+  // actual state is deadlocked too. Exceeding the node limit is reported as no deadlock. Verdicts are cached per corral
+  __INLINE__ bool checkCorralDeadlock()
+  {
+    // Getting the pusher-reachable area. Anything else that is neither a wall nor a box belongs to a corral
+    _candidateBits.copyFrom(_level->getFloorBits());
+    _candidateBits.andNotWith(getPusherReach());
+    _candidateBits.andNotWith(_boxBits);
+    if (_candidateBits.any() == false) return false;
+
+    // Saving the actual box layout, since the local searches work on the box bitboard directly
+    _savedBoxBits.copyFrom(_boxBits);
+
+    bool isDeadlock = false;
+    while (isDeadlock == false && _candidateBits.any())
+    {
+      // Isolating the next corral region
+      _blockedBits.copyFrom(_candidateBits);
+      _blockedBits.invert();
+      floodFill(_corralBits, _candidateBits.findFirst(), _blockedBits);
+      _candidateBits.andNotWith(_corralBits);
+
+      // Getting the boxes bordering the corral
+      _floodBits.reset();
+      _floodBits.orShifted(_corralBits, 1);
+      _floodBits.orShifted(_corralBits, -1);
+      _floodBits.orShifted(_corralBits, getStride());
+      _floodBits.orShifted(_corralBits, -(int64_t)getStride());
+      _floodBits.andWith(_savedBoxBits);
+
+      _corralBoxes.clear();
+      for (size_t w = 0; w < _floodBits.getWordCount(); w++)
+       for (uint64_t word = _floodBits.getWord(w); word != 0; word &= word - 1) _corralBoxes.push_back(w * 64 + __builtin_ctzll(word));
+
+      // A corral whose boxes are all on goals needs no resolving
+      bool allOnGoal = true;
+      for (const auto boxIdx : _corralBoxes) if (_level->getGoalBits().test(boxIdx) == false) allOnGoal = false;
+      if (allOnGoal) continue;
+
+      isDeadlock = isCorralDeadlocked();
+    }
+
+    // Restoring the actual box layout
+    _boxBits.copyFrom(_savedBoxBits);
+
+    return isDeadlock;
+  }
+  // Maintained incrementally by move() and undo(), so it costs nothing regardless of the room size
+  __INLINE__ size_t getBoxesOnGoal() const { return _boxesOnGoal; }
 
   __INLINE__ size_t getGoalCount() const
   {
     return _goalCount;
   }
 
+  // Returns the minimum number of pushes needed to bring a box from the given square to the given goal (by goal number),
+  // ignoring other boxes. Squares from which the goal cannot be reached return unreachableDistance
+  __INLINE__ uint16_t getPushDistance(const cellIndex_t index, const size_t goal) const { return _level->getPushDistance(index, goal); }
+
+  __INLINE__ void setHeuristicType(const heuristicType type) { _heuristicType = type; _isMatchingValid = false; }
+  __INLINE__ heuristicType getHeuristicType() const { return _heuristicType; }
+
+  // Evaluates the selected heuristic. Boxes that cannot reach any (free) goal contribute unreachableDistance
   __INLINE__ uint32_t getTotalDistanceToGoal()
   {
-    memcpy(_tmp, _tiles, sizeof(uint8_t) * _height * _width);
-    uint32_t totalDistance = 0;
+    if (_heuristicType == heuristicType::minimumMatching) return getMinimumMatchingDistance();
 
-    // Getting pusher position
-    const auto pusherPosY = _state[0];
-    const auto pusherPosX = _state[1];
-    const auto pusherIdx = getIndex(pusherPosY, pusherPosX); 
-    if (_background[pusherIdx] == itemType::goal) _tmp[pusherIdx] = itemType::goal;
-
-    // For each of the boxes
-    for (size_t box = 0; box < _boxCount; box++) 
-    {
-      auto boxPosY = _state[(box+1) * 2 + 0];
-      auto boxPosX = _state[(box+1) * 2 + 1];
-      const auto boxIdx = getIndex(boxPosY, boxPosX); 
-      
-      // If box is on goal continue
-      if (_background[boxIdx] == itemType::goal)  continue;
-
-      // Storing index of the closest goal
-      uint16_t shortestGoalIndex = 0;
-      uint32_t shortestGoalDistance = _height + _width;
-
-      // Look for the closest free goal
-      for (size_t i = 0; i < _height; i++)
-      for (size_t j = 0; j < _width; j++)
-      {
-        // Getting index
-        const auto curIndex = getIndex(i, j);
-        if (_tmp[curIndex] == itemType::goal) 
-        {
-          // Getting distance
-          const uint32_t curDistance = std::abs((int)boxPosY - (int)i) + std::abs((int)boxPosX - (int)j);
-          if (curDistance < shortestGoalDistance)
-          {
-            shortestGoalDistance = curDistance;
-            shortestGoalIndex = curIndex;
-          }
-        }
-      }
+    uint32_t totalDistance = 0;
+    for (size_t box = 0; box < _boxCount; box++) totalDistance += _level->getMinPushDistance(getIndex(_state[(box+1) * 2 + 0], _state[(box+1) * 2 + 1]));
+    return totalDistance;
+  }
 
-      if (shortestGoalIndex == 0) JAFFAR_THROW_RUNTIME("Could not find a goal for the box");
+  // Returns the total push distance of the minimum-cost perfect matching between boxes and goals, found with the Hungarian
+  // algorithm. The matching and its dual potentials are kept between calls: if only a few boxes were pushed since the last
+  // evaluation, only their rows are unassigned and re-augmented (O(n^2) each) instead of solving from scratch (O(n^3))
+  __INLINE__ uint32_t getMinimumMatchingDistance()
+  {
+    const size_t n = _boxCount;
 
-      // Replacing shortest goal so it's not used again
-      _tmp[shortestGoalIndex] = itemType::box_on_goal;
+    // Starting from an empty matching if there is no previous one, or too many boxes moved since
+    if (_isMatchingValid == false || _matchDirtyCount > n / 2)
+    {
+      _matchU.assign(n + 1, 0);
+      _matchV.assign(n + 1, 0);
+      _matchColRow.assign(n + 1, 0);
+      _matchRowCol.assign(n + 1, 0);
+      _matchDirty.assign(n + 1, 1);
+      _matchWay.resize(n + 1);
+      _matchMinV.resize(n + 1);
+      _matchUsed.resize(n + 1);
+      _matchDirtyCount = n;
+    }
 
-      // Adding distance
-      totalDistance += shortestGoalDistance;
+    // Unassigning the rows of the moved boxes. Column potentials are never positive and costs never negative, so a zero row
+    // potential keeps their reduced costs non-negative
+    for (size_t row = 1; row <= n; row++) if (_matchDirty[row] && _matchRowCol[row] != 0)
+    {
+      _matchColRow[_matchRowCol[row]] = 0;
+      _matchRowCol[row] = 0;
+      _matchU[row] = 0;
     }
 
+    // Re-augmenting them
+    for (size_t row = 1; row <= n; row++) if (_matchDirty[row]) { augmentMatching(row); _matchDirty[row] = 0; }
+    for (size_t col = 1; col <= n; col++) _matchRowCol[_matchColRow[col]] = col;
+    _matchDirtyCount = 0;
+    _isMatchingValid = true;
+
+    uint32_t totalDistance = 0;
+    for (size_t row = 1; row <= n; row++) totalDistance += getMatchingCost(row, _matchRowCol[row]);
     return totalDistance;
   }
 
-  __INLINE__ uint8_t* getState() const { return _state; }
+  __INLINE__ const uint8_t* getState() const { return (const uint8_t*)_state.data(); }
   
   __INLINE__ void loadState(jaffarCommon::deserializer::Base &deserializer)
   {
-    deserializer.pop(_state, _stateSize);
-    updateTiles();
+    // Clearing only the bits of the current boxes, rather than the whole bitboard
+    clearBoxBits();
+
+    if (_stateFormat == stateFormat::raw) deserializer.pop(_state.data(), _stateSize);
+    if (_stateFormat == stateFormat::packed)
+    {
+      deserializer.pop(_packedState.data(), _level->getPackedStateSize());
+      unpackState();
+    }
+
+    updateBoxBits();
+    updateStateHash();
+    _isMatchingValid = false;
+    _isNormalizedPusherValid = false;
+    _isPusherReachValid = false;
   }
 
   __INLINE__ void saveState(jaffarCommon::serializer::Base &serializer) const
   {
-    serializer.push(_state, _stateSize);
+    if (_stateFormat == stateFormat::packed)
+    {
+      packState();
+      serializer.push(_packedState.data(), _level->getPackedStateSize());
+      return;
+    }
+
+    if (_isNormalizedState == false) { serializer.push(_state.data(), _stateSize); return; }
+
+    // Storing the normalized pusher position in place of the actual one
+    const auto pusherIdx = getNormalizedPusherIndex();
+    const Coord pusherPos[2] = { (Coord)getRow(pusherIdx), (Coord)getColumn(pusherIdx) };
+    serializer.push(pusherPos, sizeof(pusherPos));
+    serializer.push(&_state[2], _stateSize - sizeof(pusherPos));
+  }
+
+  // Size of a saved state in the selected format
+  __INLINE__ size_t getStateSize() const { return _stateFormat == stateFormat::packed ? _level->getPackedStateSize() : _stateSize; }
+
+  __INLINE__ void setStateFormat(const stateFormat format) { _stateFormat = format; }
+  __INLINE__ stateFormat getStateFormat() const { return _stateFormat; }
+
+  // Zobrist hash of the current state, maintained incrementally by move(). In normalized mode, the pusher key is that of the
+  // normalized pusher position
+  __INLINE__ stateHash_t getStateHash() const
+  {
+    if (_isNormalizedState == false) return _stateHash;
+    return _stateHash ^ _level->getPusherKey(getIndex(_state[0], _state[1])) ^ _level->getPusherKey(getNormalizedPusherIndex());
   }
 
-  __INLINE__ size_t getStateSize() const { return _stateSize; }
+  // Zobrist hash of the box configuration alone, i.e., the state hash without its pusher key
+  __INLINE__ stateHash_t getBoxHash() const { return _stateHash ^ _level->getPusherKey(getIndex(_state[0], _state[1])); }
+
+  // When enabled, saved states and state hashes replace the pusher position with the top-left square of the area it can walk
+  // to, so states that differ only in where the pusher stands within that area collapse into one. These states are meant for
+  // push-level searches: loading one places the pusher elsewhere in its area, so step inputs recorded from the original
+  // position no longer apply
+  __INLINE__ void setNormalizedState(const bool isNormalizedState) { _isNormalizedState = isNormalizedState; _isNormalizedPusherValid = false; _isPusherReachValid = false; }
+  __INLINE__ bool getNormalizedState() const { return _isNormalizedState; }
+
+  // Returns the top-left square of the pusher's area. It only changes when a box moves, so it is cached across walking moves
+  __INLINE__ cellIndex_t getNormalizedPusherIndex() const
+  {
+    if (_isNormalizedPusherValid == false)
+    {
+      _normalizedPusherIdx = getPusherReach().findFirst();
+      _isNormalizedPusherValid = true;
+    }
+
+    return _normalizedPusherIdx;
+  }
 
   private:
 
@@ -335,95 +926,407 @@ class Room
     const auto nextTileIndex = getIndex(nextTilePosY, nextTilePosX);
 
     // Checking for wall immediately close
-    if (_background[nextTileIndex] == itemType::wall) return false;
+    if (_level->getWallBits().test(nextTileIndex)) return false;
 
     // Checking for box
-    const auto nextTileType = _tiles[nextTileIndex];
-    if (nextTileType == itemType::box || nextTileType == itemType::box_on_goal)
+    if (_boxBits.test(nextTileIndex))
     {
         const auto nextTile2PosY = pusherPosY+(2 * deltaY);
         const auto nextTile2PosX = pusherPosX+(2 * deltaX);
         const auto nextTile2Index = getIndex(nextTile2PosY, nextTile2PosX);
 
-        // If the other one is wall, then cannot move
-        if (_background[nextTile2Index] == itemType::wall) return false;
-
-        // If the other one is box, then cannot move
-        if (_tiles[nextTile2Index] == itemType::box || _tiles[nextTile2Index] == itemType::box_on_goal) return false;
+        // If the other one is wall or box, then cannot move
+        if (_level->getWallBits().test(nextTile2Index) || _boxBits.test(nextTile2Index)) return false;
     }
 
     // No restrictions
     return true;
   }
   
-  __INLINE__ void updateTiles()
+  // Sets the bits of the boxes in the state, which must be clear, and recounts the boxes on goal
+  __INLINE__ void updateBoxBits()
   {
-    memcpy(_tiles, _background, _height * _width * sizeof(uint8_t));
-
-    // Locating pusher's target destination
-    const auto pusherPosY = _state[0];
-    const auto pusherPosX = _state[1];
-    const auto pusherIdx = getIndex(pusherPosY, pusherPosX);
-    if (_background[pusherIdx] == itemType::goal) _tiles[pusherIdx] = itemType::pusher_on_goal;
-    else _tiles[pusherIdx] = itemType::pusher;
-
-    // Placing boxes
+    _boxesOnGoal = 0;
     for (size_t i = 0; i < _boxCount; i++)
     {
-      auto boxPosY = _state[(i+1) * 2 + 0];
-      auto boxPosX = _state[(i+1) * 2 + 1];
-      const auto boxIdx = getIndex(boxPosY, boxPosX); 
-      if (_background[boxIdx] == itemType::goal) _tiles[boxIdx] = itemType::box_on_goal;
-      else _tiles[boxIdx] = itemType::box;
+      const auto boxIdx = getIndex(_state[(i+1) * 2 + 0], _state[(i+1) * 2 + 1]);
+      _boxBits.set(boxIdx);
+      _boxesOnGoal += _level->getGoalBits().test(boxIdx);
     }
   }
 
+  __INLINE__ void clearBoxBits()
+  {
+    for (size_t i = 0; i < _boxCount; i++) _boxBits.clear(getIndex(_state[(i+1) * 2 + 0], _state[(i+1) * 2 + 1]));
+  }
+
+  // Returns the LURD character for a direction, uppercase for pushes
+  __INLINE__ static char getDirectionInput(const int8_t deltaY, const int8_t deltaX, const bool isPush)
+  {
+    char input = 'u';
+    if (deltaY > 0) input = 'd';
+    if (deltaX < 0) input = 'l';
+    if (deltaX > 0) input = 'r';
+    return isPush ? input - 'a' + 'A' : input;
+  }
+
+  // Fills 'result' with the cells connected to 'start' through non-blocked cells. Boards of runtime size can be large, so they
+  // are filled run by run; fixed-size ones are small enough for the word-parallel fill to pay off
+  __INLINE__ void floodFill(bitboard_t& result, const cellIndex_t start, const bitboard_t& blocked) const
+  {
+    if constexpr (MaxCells == 0) result.floodFill(start, blocked, getStride(), _floodSeeds);
+    else result.floodFill(start, blocked, getStride(), _floodBits);
+  }
 
-  __INLINE__ void updateState()
+  // Hashes a box layout (given in row-major order) together with a normalized pusher position
+  __INLINE__ uint64_t hashBoxLayout(const cellIndex_t* boxes, const size_t count, const cellIndex_t pusherIdx) const
   {
-    size_t currentPos = 1;
-    for (uint8_t i = 0; i < _height; i++)
-    for (uint8_t j = 0; j < _width; j++)
+    uint64_t hash = 0x9E3779B97F4A7C15ull ^ pusherIdx;
+    for (size_t i = 0; i < count; i++)
     {
-       if (_tiles[getIndex(i,j)] == itemType::pusher)
-       { 
-           _state[0] = i;
-           _state[1] = j;
-       }
-       
-       if (_tiles[getIndex(i,j)] == itemType::box)
-       {
-            _state[currentPos * 2 + 0] = i;
-            _state[currentPos * 2 + 1] = j;
-            currentPos++;
-       }
+      hash ^= boxes[i] + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2);
+      hash *= 0xBF58476D1CE4E5B9ull;
+    }
+    return hash ^ (hash >> 31);
+  }
 
-       if (_tiles[getIndex(i,j)] == itemType::box_on_goal)
+  // Runs the local push search for the corral currently in _corralBits, bordered by the boxes in _corralBoxes.
+  // Search nodes are stored flat as the sorted box indices followed by the pusher index
+  inline bool isCorralDeadlocked()
+  {
+    const size_t boxCount = _corralBoxes.size();
+    const size_t nodeSize = boxCount + 1;
+    const int offsets[4] = { -(int)getStride(), (int)getStride(), -1, 1 };
+
+    // Setting the relaxed board, with only the corral boxes
+    _boxBits.reset();
+    for (const auto boxIdx : _corralBoxes) _boxBits.set(boxIdx);
+
+    // Looking up the cache, keyed by the corral boxes, the corral region and the pusher's relaxed area
+    _blockedBits.copyFrom(_level->getWallBits());
+    _blockedBits.orWith(_boxBits);
+    floodFill(_reachBits, getIndex(_state[0], _state[1]), _blockedBits);
+    const uint64_t cacheKey = hashBoxLayout(_corralBoxes.data(), boxCount, _reachBits.findFirst()) * 31 + _corralBits.findFirst();
+    const auto cacheEntry = _corralCache.find(cacheKey);
+    if (cacheEntry != _corralCache.end()) return cacheEntry->second;
+
+    // Initializing search
+    _corralQueue.assign(_corralBoxes.begin(), _corralBoxes.end());
+    _corralQueue.push_back(getIndex(_state[0], _state[1]));
+    _corralNode.assign(_corralQueue.begin(), _corralQueue.end());
+    _corralVisited.clear();
+
+    bool isDeadlock = true;
+    size_t nodeCount = 0;
+    for (size_t nodePos = 0; nodePos < _corralQueue.size(); nodePos += nodeSize)
+    {
+      // Giving up if the node limit is exceeded
+      if (nodeCount++ >= _corralSearchLimit) { isDeadlock = false; break; }
+
+      // Setting the relaxed board for this node
+      for (size_t i = 0; i < boxCount; i++) _boxBits.clear(_corralNode[i]);
+      _corralNode.assign(_corralQueue.begin() + nodePos, _corralQueue.begin() + nodePos + nodeSize);
+      const cellIndex_t* boxes = _corralNode.data();
+      for (size_t i = 0; i < boxCount; i++) _boxBits.set(boxes[i]);
+
+      // Getting the pusher's area. If it reaches into the corral, the corral has been opened
+      _blockedBits.copyFrom(_level->getWallBits());
+      _blockedBits.orWith(_boxBits);
+      floodFill(_reachBits, boxes[boxCount], _blockedBits);
+      if (_reachBits.intersects(_corralBits)) { isDeadlock = false; break; }
+
+      // Skipping already visited layouts
+      if (_corralVisited.insert(hashBoxLayout(boxes, boxCount, _reachBits.findFirst())).second == false) continue;
+
+      // If all the corral boxes are on goals, the corral has been solved
+      bool allOnGoal = true;
+      for (size_t i = 0; i < boxCount; i++) if (_level->getGoalBits().test(boxes[i]) == false) allOnGoal = false;
+      if (allOnGoal) { isDeadlock = false; break; }
+
+      // Expanding all pushes of the corral boxes that do not lead to a simple deadlock
+      for (size_t i = 0; i < boxCount; i++)
+       for (const auto offset : offsets)
        {
-            _state[currentPos * 2 + 0] = i;
-            _state[currentPos * 2 + 1] = j;
-            currentPos++;
+         const cellIndex_t boxIdx = boxes[i];
+         const cellIndex_t behindIdx = boxIdx - offset;
+         const cellIndex_t aheadIdx = boxIdx + offset;
+         if (_reachBits.test(behindIdx) == false) continue;
+         if (_level->getWallBits().test(aheadIdx) || _boxBits.test(aheadIdx)) continue;
+
+         _boxBits.clear(boxIdx);
+         _boxBits.set(aheadIdx);
+         const bool isPushDeadlock = checkBoxDeadlock(aheadIdx);
+         _boxBits.clear(aheadIdx);
+         _boxBits.set(boxIdx);
+         if (isPushDeadlock) continue;
+
+         // Adding child node, keeping the boxes sorted
+         const size_t childPos = _corralQueue.size();
+         for (size_t j = 0; j < boxCount; j++) _corralQueue.push_back(j == i ? aheadIdx : boxes[j]);
+         std::sort(_corralQueue.begin() + childPos, _corralQueue.begin() + childPos + boxCount);
+         _corralQueue.push_back(boxIdx);
        }
     }
+
+    // Storing the verdict, starting over if the cache grew too large
+    if (_corralCache.size() >= _corralCacheLimit) _corralCache.clear();
+    _corralCache[cacheKey] = isDeadlock;
+    return isDeadlock;
   }
 
-  __INLINE__ uint16_t getIndex(const uint8_t i, const uint8_t j) const { return (uint16_t)i * (uint16_t)_width + (uint16_t)j; }
+  // Matching cost of box row 'row' (state slot row - 1) and goal column 'col' (goal number col - 1)
+  __INLINE__ int64_t getMatchingCost(const size_t row, const size_t col) const
+  {
+    return getPushDistance(getIndex(_state[row * 2 + 0], _state[row * 2 + 1]), col - 1);
+  }
 
-  uint8_t* _background = nullptr;
-  uint8_t* _tiles = nullptr;
-  
-  uint8_t* _tmp = nullptr; // for temporary calculations
+  // Hungarian algorithm step: adds the given unassigned row to the matching through a shortest augmenting path over reduced
+  // costs, updating the dual potentials so that all matched pairs stay tight
+  __INLINE__ void augmentMatching(const size_t row)
+  {
+    const size_t n = _boxCount;
+    _matchColRow[0] = row;
+    size_t col0 = 0;
+    std::fill(_matchMinV.begin(), _matchMinV.end(), INT64_MAX);
+    std::fill(_matchUsed.begin(), _matchUsed.end(), 0);
+
+    do
+    {
+      _matchUsed[col0] = 1;
+      const size_t row0 = _matchColRow[col0];
+      int64_t delta = INT64_MAX;
+      size_t col1 = 0;
+      for (size_t col = 1; col <= n; col++) if (_matchUsed[col] == 0)
+      {
+        const int64_t reducedCost = getMatchingCost(row0, col) - _matchU[row0] - _matchV[col];
+        if (reducedCost < _matchMinV[col]) { _matchMinV[col] = reducedCost; _matchWay[col] = col0; }
+        if (_matchMinV[col] < delta) { delta = _matchMinV[col]; col1 = col; }
+      }
+
+      for (size_t col = 0; col <= n; col++)
+      {
+        if (_matchUsed[col]) { _matchU[_matchColRow[col]] += delta; _matchV[col] -= delta; }
+        else _matchMinV[col] -= delta;
+      }
+
+      col0 = col1;
+    } while (_matchColRow[col0] != 0);
+
+    // Flipping the augmenting path
+    do
+    {
+      const size_t col1 = _matchWay[col0];
+      _matchColRow[col0] = _matchColRow[col1];
+      col0 = col1;
+    } while (col0 != 0);
+  }
+
+  // Called after a push moved a box from one state slot to another. The rows in between shift by one, so the per-row matching
+  // data is rotated the same way, and the moved box's row is flagged for repair on the next evaluation
+  __INLINE__ void onMatchedBoxMoved(const size_t fromSlot, const size_t toSlot)
+  {
+    const size_t fromRow = fromSlot + 1;
+    const size_t toRow = toSlot + 1;
+    if (fromRow < toRow)
+    {
+      std::rotate(&_matchU[fromRow], &_matchU[fromRow + 1], &_matchU[toRow + 1]);
+      std::rotate(&_matchRowCol[fromRow], &_matchRowCol[fromRow + 1], &_matchRowCol[toRow + 1]);
+      std::rotate(&_matchDirty[fromRow], &_matchDirty[fromRow + 1], &_matchDirty[toRow + 1]);
+    }
+    if (toRow < fromRow)
+    {
+      std::rotate(&_matchU[toRow], &_matchU[fromRow], &_matchU[fromRow + 1]);
+      std::rotate(&_matchRowCol[toRow], &_matchRowCol[fromRow], &_matchRowCol[fromRow + 1]);
+      std::rotate(&_matchDirty[toRow], &_matchDirty[fromRow], &_matchDirty[fromRow + 1]);
+    }
+
+    for (size_t row = std::min(fromRow, toRow); row <= std::max(fromRow, toRow); row++) if (_matchRowCol[row] != 0) _matchColRow[_matchRowCol[row]] = row;
+    if (_matchDirty[toRow] == 0) { _matchDirty[toRow] = 1; _matchDirtyCount++; }
+  }
+
+  __INLINE__ void packState() const
+  {
+    const cellIndex_t pusherIdx = _isNormalizedState ? getNormalizedPusherIndex() : getIndex(_state[0], _state[1]);
+    const cellIndex_t densePusher = _level->getDenseIndex(pusherIdx);
+    for (size_t byte = 0; byte < _level->getPackedPusherSize(); byte++) _packedState[byte] = densePusher >> (8 * byte);
+
+    uint8_t* occupancy = &_packedState[_level->getPackedPusherSize()];
+    memset(occupancy, 0, _level->getPackedStateSize() - _level->getPackedPusherSize());
+    for (size_t i = 0; i < _boxCount; i++)
+    {
+      const cellIndex_t denseBox = _level->getDenseIndex(getIndex(_state[(i+1) * 2 + 0], _state[(i+1) * 2 + 1]));
+      occupancy[denseBox >> 3] |= 1 << (denseBox & 7);
+    }
+  }
+
+  // Rebuilds the raw state from the packed one. Dense indexes follow row-major order, so boxes come out already sorted
+  __INLINE__ void unpackState()
+  {
+    cellIndex_t densePusher = 0;
+    for (size_t byte = 0; byte < _level->getPackedPusherSize(); byte++) densePusher |= (cellIndex_t)_packedState[byte] << (8 * byte);
+    const cellIndex_t pusherIdx = _level->getDenseCell(densePusher);
+    _state[0] = getRow(pusherIdx);
+    _state[1] = getColumn(pusherIdx);
+
+    const uint8_t* occupancy = &_packedState[_level->getPackedPusherSize()];
+    size_t slot = 1;
+    for (size_t byte = 0; byte < _level->getPackedStateSize() - _level->getPackedPusherSize(); byte++)
+     for (uint8_t bits = occupancy[byte]; bits != 0; bits &= bits - 1)
+     {
+       const cellIndex_t boxIdx = _level->getDenseCell(byte * 8 + __builtin_ctz(bits));
+       _state[slot * 2 + 0] = getRow(boxIdx);
+       _state[slot * 2 + 1] = getColumn(boxIdx);
+       slot++;
+     }
+  }
+
+  // Full recomputation of the state hash, needed only after loading a state
+  __INLINE__ void updateStateHash()
+  {
+    _stateHash = _level->getPusherKey(getIndex(_state[0], _state[1]));
+    for (size_t i = 0; i < _boxCount; i++) _stateHash ^= _level->getBoxKey(getIndex(_state[(i+1) * 2 + 0], _state[(i+1) * 2 + 1]));
+  }
+
+  // Returns the three cells starting at the given index that are blocked by either a wall or a box
+  __INLINE__ uint64_t getBlockedBits(const cellIndex_t index) const { return _level->getWallBits().getBits(index, 3) | _boxBits.getBits(index, 3); }
 
-  uint8_t _width = 0;
-  uint8_t _height = 0;
+  // Finds the state slot of the box at the given position. Boxes are kept in row-major order, so a binary search suffices
+  __INLINE__ size_t findBoxSlot(const cellIndex_t boxIdx) const
+  {
+    size_t lo = 0;
+    size_t hi = _boxCount;
+    while (lo < hi)
+    {
+      const size_t mid = (lo + hi) / 2;
+      const auto midIdx = getIndex(_state[(mid+1) * 2 + 0], _state[(mid+1) * 2 + 1]);
+      if (midIdx < boxIdx) lo = mid + 1;
+      else hi = mid;
+    }
+
+    return lo;
+  }
 
-  uint8_t* _state = nullptr;
-  size_t _stateSize;
+  // Moves the box in the given slot to a new position, shifting its neighbours to keep the canonical row-major box order.
+  // Only the boxes lying between the old and new positions are touched, so horizontal pushes never shift and vertical pushes
+  // shift at most the boxes found within one row's span
+  __INLINE__ size_t relocateBox(size_t slot, const cellIndex_t newIdx)
+  {
+    // Shifting boxes with a larger index back, if the box moved forward
+    while (slot + 1 < _boxCount && getIndex(_state[(slot+2) * 2 + 0], _state[(slot+2) * 2 + 1]) < newIdx)
+    {
+      _state[(slot+1) * 2 + 0] = _state[(slot+2) * 2 + 0];
+      _state[(slot+1) * 2 + 1] = _state[(slot+2) * 2 + 1];
+      slot++;
+    }
+
+    // Shifting boxes with a smaller index forward, if the box moved backward
+    while (slot > 0 && getIndex(_state[slot * 2 + 0], _state[slot * 2 + 1]) > newIdx)
+    {
+      _state[(slot+1) * 2 + 0] = _state[slot * 2 + 0];
+      _state[(slot+1) * 2 + 1] = _state[slot * 2 + 1];
+      slot--;
+    }
+
+    _state[(slot+1) * 2 + 0] = getRow(newIdx);
+    _state[(slot+1) * 2 + 1] = getColumn(newIdx);
+
+    return slot;
+  }
+
+  __INLINE__ cellIndex_t getStride() const { if constexpr (Stride > 0) return Stride; else return _stride; }
+  __INLINE__ cellIndex_t getIndex(const uint16_t i, const uint16_t j) const { return (cellIndex_t)i * getStride() + j; }
+  __INLINE__ uint16_t getRow(const cellIndex_t index) const { return index / getStride(); }
+  __INLINE__ uint16_t getColumn(const cellIndex_t index) const { return index % getStride(); }
+
+  // Shared read-only level data
+  std::shared_ptr<const Level> _level;
+
+  // Per-instance state touched by every move, packed together from the start of a cache line: the state hash, the raw state
+  // buffer, the box bitboard and the level dimensions, cached here to avoid going through the level on each index computation
+  alignas(64) stateHash_t _stateHash = 0;
+  std::conditional_t<MaxBoxes == 0, std::vector<Coord>, std::array<Coord, 2 * (1 + MaxBoxes)>> _state {};
+  bitboard_t _boxBits;
+  uint16_t _stride = 0;
+  uint16_t _width = 0;
+  uint16_t _height = 0;
+  bool _movedBox = false;
+  size_t _boxesOnGoal = 0;
+  size_t _stateSize = 0;
   size_t _boxCount = 0;
   size_t _goalCount = 0;
 
-  bool _movedBox = false;
+  // Heuristic selection and the Hungarian matching state: row/column dual potentials, column-to-row and row-to-column
+  // assignments (1-based, 0 meaning unassigned) and rows pending repair
+  heuristicType _heuristicType = heuristicType::nearestGoal;
+  bool _isMatchingValid = false;
+  std::vector<int64_t> _matchU;
+  std::vector<int64_t> _matchV;
+  std::vector<size_t> _matchColRow;
+  std::vector<size_t> _matchRowCol;
+  std::vector<uint8_t> _matchDirty;
+  size_t _matchDirtyCount = 0;
+  std::vector<size_t> _matchWay;
+  std::vector<int64_t> _matchMinV;
+  std::vector<uint8_t> _matchUsed;
+
+  // Boxes assumed frozen during the freeze deadlock check
+  bitboard_t _freezeBits;
+  std::vector<cellIndex_t> _freezeStack;
+
+  // Shared cache of freeze verdicts, and the box whose verdict is being worked out for it
+  std::shared_ptr<DeadlockPatternCache> _deadlockPatternCache;
+  cellIndex_t _freezeCenter = 0;
+  bool _isFreezeLocal = false;
+
+  // Whether pushes are followed by their macros, and the moves made by the last one
+  bool _isPushMacroEnabled = false;
+  std::vector<Level::macroStep_t> _macroSteps;
+
+  // Scratch bitboards for flood fills and the corral analysis
+  mutable bitboard_t _floodBits;
+  mutable std::vector<uint32_t> _floodSeeds;
+  bitboard_t _reachBits;
+  mutable bitboard_t _blockedBits;
+  bitboard_t _corralBits;
+  bitboard_t _candidateBits;
+  bitboard_t _savedBoxBits;
+
+  // Corral local search storage and verdict cache
+  std::vector<cellIndex_t> _corralBoxes;
+  std::vector<cellIndex_t> _corralQueue;
+  std::vector<cellIndex_t> _corralNode;
+  std::unordered_set<uint64_t> _corralVisited;
+  std::unordered_map<uint64_t, bool> _corralCache;
+  size_t _corralSearchLimit = 1024;
+  size_t _corralCacheLimit = 1 << 20;
+
+  // Pusher path search storage
+  mutable bitboard_t _pathVisitedBits;
+  mutable std::vector<uint8_t> _pathDirections;
+  mutable std::vector<cellIndex_t> _pathQueue;
+
+  // Saved state format and the packed state buffer
+  stateFormat _stateFormat = stateFormat::raw;
+  mutable std::vector<uint8_t> _packedState;
+
+  // Cached pusher-reachable area
+  mutable bool _isPusherReachValid = false;
+  mutable bitboard_t _pusherReachBits;
+
+  // Normalized state mode and the cached normalized pusher position
+  bool _isNormalizedState = false;
+  mutable bool _isNormalizedPusherValid = false;
+  mutable cellIndex_t _normalizedPusherIdx = 0;
 
 };
 
+// The general variant, for levels of any size, and the variants specialized for small levels
+typedef BasicRoom<0, 0, 0> Room;
+typedef BasicRoom<8, 64, 32> Room8x8;
+typedef BasicRoom<16, 128, 32> Room16x8;
+typedef BasicRoom<16, 256, 64> Room16x16;
+
+// The general variant with 16-bit coordinates in the raw state, for rooms with more than 256 squares per side
+typedef BasicRoom<0, 0, 0, uint16_t> RoomWide;
+
 } // namespace quickerBan
\ No newline at end of file
@@ -0,0 +1,901 @@
+#include "argparse/argparse.hpp"
+#include <jaffarCommon/json.hpp>
+#include <jaffarCommon/serializers/contiguous.hpp>
+#include <jaffarCommon/deserializers/contiguous.hpp>
+#include <jaffarCommon/hash.hpp>
+#include <jaffarCommon/timing.hpp>
+#include <jaffarCommon/logger.hpp>
+#include <jaffarCommon/file.hpp>
+#include "emuInstance.hpp"
+#include "stateHashSet.hpp"
+#include "boxConfigurationSet.hpp"
+#include "stateStore.hpp"
+#include <omp.h>
+#include <sys/resource.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+#include <string>
+
+// Hashes are already uniformly distributed, so the table only needs to fold them into a single word
+struct stateHashHasher_t
+{
+  size_t operator()(const jaffarCommon::hash::hash_t& hash) const { return hash.first ^ hash.second; }
+};
+
+// Statistics reported at the end of the search
+struct searchStats_t
+{
+  size_t expandedNodes = 0;
+  size_t generatedNodes = 0;
+  size_t iterations = 0;
+  bool hitNodeLimit = false;
+};
+
+// Returns the heuristic value of the current state: a lower bound on the remaining pushes
+static inline uint32_t getHeuristic(jaffar::EmuInstance& e) { return e.getTotalDistance(); }
+
+static inline bool isSolved(jaffar::EmuInstance& e) { return e.getBoxesOnGoal() == std::min(e.getLevel()->getBoxCount(), e.getGoalCount()); }
+
+// Tells whether the state reached by the last push can be discarded
+static inline bool isPruned(jaffar::EmuInstance& e, const bool checkCorrals)
+{
+  if (e.getIsDeadlock()) return true;
+  if (checkCorrals && e.getIsCorralDeadlock()) return true;
+  return false;
+}
+
+// A* over pushes. Every generated state is stored once (serialized) in a flat arena, and the transposition table maps state
+// hashes to their node, which holds the push that reached it and its parent, so the solution is rebuilt by walking back
+static bool runAStar(jaffar::EmuInstance& e, const size_t maxNodes, const bool checkCorrals, std::vector<quickerBan::Room::push_t>& solution, searchStats_t& stats)
+{
+  struct node_t
+  {
+    uint32_t parent;
+    quickerBan::Room::push_t push;
+    uint32_t g;
+  };
+
+  // Open list entry. Ties on f are broken in favour of deeper nodes, which are closer to a solution
+  struct openEntry_t
+  {
+    uint32_t f;
+    uint32_t g;
+    uint32_t node;
+    bool operator<(const openEntry_t& other) const { return f != other.f ? f > other.f : g < other.g; }
+  };
+
+  const size_t stateSize = e.getStateSize();
+  std::vector<node_t> nodes;
+  std::vector<uint8_t> states;
+  std::unordered_map<jaffarCommon::hash::hash_t, uint32_t, stateHashHasher_t> visited;
+  std::priority_queue<openEntry_t> open;
+  std::vector<quickerBan::Room::push_t> pushes;
+  quickerBan::Room::moveDelta_t delta;
+
+  // Appends the current state to the arena
+  const auto storeState = [&]()
+  {
+    states.resize(states.size() + stateSize);
+    jaffarCommon::serializer::Contiguous s(&states[states.size() - stateSize], stateSize);
+    e.serializeState(s);
+  };
+
+  // Storing the root
+  nodes.push_back(node_t{ std::numeric_limits<uint32_t>::max(), quickerBan::Room::push_t{ 0, 0, 0 }, 0 });
+  storeState();
+  visited.emplace(e.getStateHash(), 0);
+  open.push(openEntry_t{ getHeuristic(e), 0, 0 });
+
+  while (open.empty() == false)
+  {
+    const auto entry = open.top();
+    open.pop();
+
+    // Skipping entries superseded by a shorter path to the same node
+    if (entry.g != nodes[entry.node].g) continue;
+
+    // Restoring the node's state
+    jaffarCommon::deserializer::Contiguous d(&states[(size_t)entry.node * stateSize], stateSize);
+    e.deserializeState(d);
+
+    // Checking for a solution
+    if (isSolved(e))
+    {
+      for (uint32_t n = entry.node; n != 0; n = nodes[n].parent) solution.push_back(nodes[n].push);
+      std::reverse(solution.begin(), solution.end());
+      return true;
+    }
+
+    if (maxNodes > 0 && stats.expandedNodes >= maxNodes) { stats.hitNodeLimit = true; return false; }
+    stats.expandedNodes++;
+
+    // Generating children in place, each reverted right after being recorded
+    e.getPushes(pushes);
+    for (const auto& push : pushes)
+    {
+      e.advancePush(push, delta);
+      stats.generatedNodes++;
+
+      if (isPruned(e, checkCorrals) == false)
+      {
+        // A push may be followed by a macro, so the step costs as many pushes as it made
+        const uint32_t h = getHeuristic(e);
+        const uint32_t g = entry.g + e.getLastPushCount();
+        if (h < quickerBan::Room::unreachableDistance)
+        {
+          const auto [it, isNew] = visited.emplace(e.getStateHash(), (uint32_t)nodes.size());
+          if (isNew)
+          {
+            nodes.push_back(node_t{ entry.node, push, g });
+            storeState();
+            open.push(openEntry_t{ g + h, g, it->second });
+          }
+          else if (g < nodes[it->second].g)
+          {
+            nodes[it->second] = node_t{ entry.node, push, g };
+            open.push(openEntry_t{ g + h, g, it->second });
+          }
+        }
+      }
+
+      e.undoState(delta);
+    }
+  }
+
+  return false;
+}
+
+// IDA* over pushes: depth-first searches bounded by increasing f thresholds. Only the current path is kept, plus a bounded
+// transposition table (cleared on each iteration) that cuts states already reached at the same or lower depth
+class IDAStar
+{
+  public:
+
+  IDAStar(jaffar::EmuInstance& e, const size_t maxNodes, const size_t maxTableEntries, const bool checkCorrals, searchStats_t& stats)
+    : _e(e), _maxNodes(maxNodes), _maxTableEntries(maxTableEntries), _checkCorrals(checkCorrals), _stats(stats) {}
+
+  bool run(std::vector<quickerBan::Room::push_t>& solution)
+  {
+    uint32_t threshold = getHeuristic(_e);
+    while (threshold < quickerBan::Room::unreachableDistance)
+    {
+      _stats.iterations++;
+      _table.clear();
+      _path.clear();
+      _nextThreshold = quickerBan::Room::unreachableDistance;
+
+      // No path is deeper than the threshold, so each depth gets its own push buffer up front
+      _pushes.resize(threshold + 1);
+
+      if (search(0, threshold)) { solution = _path; return true; }
+      if (_stats.hitNodeLimit) return false;
+      threshold = _nextThreshold;
+    }
+
+    return false;
+  }
+
+  private:
+
+  // Recursive, so not forced inline
+  inline bool search(const uint32_t g, const uint32_t threshold)
+  {
+    if (isSolved(_e)) return true;
+    if (_maxNodes > 0 && _stats.expandedNodes >= _maxNodes) { _stats.hitNodeLimit = true; return false; }
+    _stats.expandedNodes++;
+
+    _e.getPushes(_pushes[g]);
+
+    quickerBan::Room::moveDelta_t delta;
+    for (const auto& push : _pushes[g])
+    {
+      _e.advancePush(push, delta);
+      _stats.generatedNodes++;
+
+      // A push may be followed by a macro, so the step costs as many pushes as it made. Depths along a path still increase
+      // strictly, so each keeps its own push buffer
+      bool found = false;
+      if (isPruned(_e, _checkCorrals) == false)
+      {
+        const uint32_t childG = g + _e.getLastPushCount();
+        const uint32_t f = childG + getHeuristic(_e);
+        if (f > threshold) _nextThreshold = std::min(_nextThreshold, f);
+        else if (isTransposition(childG) == false)
+        {
+          _path.push_back(push);
+          found = search(childG, threshold);
+          if (found == false) _path.pop_back();
+        }
+      }
+
+      _e.undoState(delta);
+      if (found || _stats.hitNodeLimit) return found;
+    }
+
+    return false;
+  }
+
+  // Returns true if the current state was already reached at the same or a lower depth in this iteration, and records it otherwise
+  __INLINE__ bool isTransposition(const uint32_t g)
+  {
+    const auto hash = _e.getStateHash();
+    const auto it = _table.find(hash);
+    if (it != _table.end())
+    {
+      if (it->second <= g) return true;
+      it->second = g;
+      return false;
+    }
+
+    if (_table.size() < _maxTableEntries) _table.emplace(hash, g);
+    return false;
+  }
+
+  jaffar::EmuInstance& _e;
+  const size_t _maxNodes;
+  const size_t _maxTableEntries;
+  const bool _checkCorrals;
+  searchStats_t& _stats;
+  uint32_t _nextThreshold;
+  std::vector<quickerBan::Room::push_t> _path;
+  std::vector<std::vector<quickerBan::Room::push_t>> _pushes;
+  std::unordered_map<jaffarCommon::hash::hash_t, uint32_t, stateHashHasher_t> _table;
+};
+
+// Breadth-first search over pushes, run in parallel one depth at a time. The frontier is split into chunks, and each thread
+// starts with an even share of them and steals from the back of the others' shares once its own run out. Threads expand with
+// their own EmuInstance (all sharing the level) into their own buffers, and deduplicate through a lock-free hash set. Only the
+// current frontier keeps its states; earlier depths keep just the parent and push of each node, to rebuild the solution
+class ParallelBFS
+{
+  public:
+
+  // The visited states are kept either as full state hashes, or grouped by box configuration
+  ParallelBFS(const nlohmann::json& config, const size_t maxNodes, const size_t maxTableEntries, const bool useBoxConfigurations, const bool checkCorrals, searchStats_t& stats)
+    : _config(config), _maxNodes(maxNodes), _checkCorrals(checkCorrals), _stats(stats)
+  {
+    if (useBoxConfigurations) _configurations = std::make_unique<jaffar::BoxConfigurationSet>();
+    else _visited = std::make_unique<jaffar::StateHashSet>(maxTableEntries);
+  }
+
+  bool run(jaffar::EmuInstance& e, std::vector<quickerBan::Room::push_t>& solution)
+  {
+    // Creating one instance per thread on the same level
+    const size_t threadCount = omp_get_max_threads();
+    std::vector<std::unique_ptr<jaffar::EmuInstance>> instances(threadCount);
+    for (auto& instance : instances)
+    {
+      instance = std::make_unique<jaffar::EmuInstance>(_config);
+      instance->initialize(e.getLevel());
+      instance->setDeadlockPatternCache(e.getDeadlockPatternCache());
+    }
+
+    _stateSize = e.getStateSize();
+    _threads = std::vector<threadData_t>(threadCount);
+
+    // Storing the root
+    if (isSolved(e)) return true;
+    insertVisited(e);
+    _parents.push_back({ node_t{ 0, quickerBan::Room::push_t{ 0, 0, 0 } } });
+    _frontier.resize(_stateSize);
+    jaffarCommon::serializer::Contiguous s(_frontier.data(), _stateSize);
+    e.serializeState(s);
+
+    while (_parents.back().empty() == false)
+    {
+      if (_maxNodes > 0 && _stats.expandedNodes >= _maxNodes) { _stats.hitNodeLimit = true; return false; }
+      _stats.iterations++;
+
+      const bool isNodeLimitHit = expandFrontier(instances);
+
+      // Rebuilding the solution from the first goal found, if any. Every shallower state was checked already, so it is still
+      // a shortest one even if the depth was cut short by the node limit
+      for (const auto& thread : _threads) if (thread.isSolutionFound)
+      {
+        solution.push_back(thread.solution.push);
+        for (size_t depth = _parents.size() - 1, node = thread.solution.parent; depth > 0; node = _parents[depth][node].parent, depth--) solution.push_back(_parents[depth][node].push);
+        std::reverse(solution.begin(), solution.end());
+        return true;
+      }
+
+      if (isNodeLimitHit) { _stats.hitNodeLimit = true; return false; }
+
+      // Gathering the threads' children into the next frontier
+      size_t childCount = 0;
+      for (const auto& thread : _threads) childCount += thread.parents.size();
+      _parents.emplace_back();
+      _parents.back().reserve(childCount);
+      _frontier.resize(childCount * _stateSize);
+      size_t offset = 0;
+      for (auto& thread : _threads)
+      {
+        _parents.back().insert(_parents.back().end(), thread.parents.begin(), thread.parents.end());
+        if (thread.states.empty() == false) memcpy(&_frontier[offset], thread.states.data(), thread.states.size());
+        offset += thread.states.size();
+        thread.parents.clear();
+        thread.states.clear();
+      }
+    }
+
+    return false;
+  }
+
+  private:
+
+  // How the node was reached: its parent's position within the previous depth, and the push applied to it
+  struct node_t
+  {
+    uint32_t parent;
+    quickerBan::Room::push_t push;
+  };
+
+  // Per-thread data, cache-line aligned so that the chunk ranges stolen from do not share lines
+  struct alignas(64) threadData_t
+  {
+    // Remaining chunks of this thread's share, as the next chunk (low half) and the end (high half)
+    std::atomic<uint64_t> chunks;
+    std::vector<node_t> parents;
+    std::vector<uint8_t> states;
+    std::vector<quickerBan::Room::push_t> pushes;
+    size_t expandedNodes;
+    size_t generatedNodes;
+    bool isSolutionFound;
+    node_t solution;
+  };
+
+  static constexpr size_t chunkSize = 64;
+
+  // Takes the next chunk from the front of a thread's share. Thieves take them from the back, so they rarely contend
+  static __INLINE__ bool takeChunk(std::atomic<uint64_t>& chunks, const bool fromBack, uint32_t& chunk)
+  {
+    uint64_t current = chunks.load(std::memory_order_relaxed);
+    while (true)
+    {
+      const uint32_t next = (uint32_t)current;
+      const uint32_t end = (uint32_t)(current >> 32);
+      if (next >= end) return false;
+      const uint64_t updated = fromBack ? ((uint64_t)(end - 1) << 32) | next : ((uint64_t)end << 32) | (next + 1);
+      if (chunks.compare_exchange_weak(current, updated, std::memory_order_relaxed)) { chunk = fromBack ? end - 1 : next; return true; }
+    }
+  }
+
+  // Records the current state as visited. Returns true if it was not visited already
+  __INLINE__ bool insertVisited(const jaffar::EmuInstance& e)
+  {
+    if (_configurations != nullptr) return _configurations->insert(e.getBoxHash(), e.getNormalizedPusherIndex());
+    return _visited->insert(e.getStateHash());
+  }
+
+  // Expands the current depth. Returns true if it was cut short by the node limit, which is checked each time a chunk is taken,
+  // so the search stops at most one chunk per thread past it
+  bool expandFrontier(std::vector<std::unique_ptr<jaffar::EmuInstance>>& instances)
+  {
+    const size_t threadCount = _threads.size();
+    const size_t frontierSize = _parents.back().size();
+    const size_t chunkCount = (frontierSize + chunkSize - 1) / chunkSize;
+
+    // Sharing out the chunks evenly
+    for (size_t t = 0; t < threadCount; t++)
+    {
+      const uint64_t begin = chunkCount * t / threadCount;
+      const uint64_t end = chunkCount * (t + 1) / threadCount;
+      _threads[t].chunks.store((end << 32) | begin, std::memory_order_relaxed);
+      _threads[t].expandedNodes = 0;
+      _threads[t].generatedNodes = 0;
+      _threads[t].isSolutionFound = false;
+    }
+
+    std::atomic<bool> isSolutionFound = false;
+    std::atomic<bool> isNodeLimitHit = false;
+    std::atomic<size_t> expandedNodes = _stats.expandedNodes;
+
+    #pragma omp parallel num_threads(threadCount)
+    {
+      const size_t threadId = omp_get_thread_num();
+      auto& thread = _threads[threadId];
+      auto& e = *instances[threadId];
+      quickerBan::Room::moveDelta_t delta;
+
+      uint32_t chunk;
+      while (isSolutionFound.load(std::memory_order_relaxed) == false)
+      {
+        // Handing out no more chunks once the node limit is reached
+        if (_maxNodes > 0 && expandedNodes.load(std::memory_order_relaxed) >= _maxNodes) { isNodeLimitHit.store(true, std::memory_order_relaxed); break; }
+
+        // Taking a chunk of our own, or stealing one from the other threads
+        bool hasChunk = takeChunk(thread.chunks, false, chunk);
+        for (size_t i = 1; hasChunk == false && i < threadCount; i++) hasChunk = takeChunk(_threads[(threadId + i) % threadCount].chunks, true, chunk);
+        if (hasChunk == false) break;
+
+        const size_t chunkEnd = std::min((size_t)(chunk + 1) * chunkSize, frontierSize);
+        const size_t chunkExpandedNodes = thread.expandedNodes;
+        for (size_t node = (size_t)chunk * chunkSize; node < chunkEnd && thread.isSolutionFound == false; node++)
+        {
+          jaffarCommon::deserializer::Contiguous d(&_frontier[node * _stateSize], _stateSize);
+          e.deserializeState(d);
+          thread.expandedNodes++;
+
+          e.getPushes(thread.pushes);
+          for (const auto& push : thread.pushes)
+          {
+            e.advancePush(push, delta);
+            thread.generatedNodes++;
+
+            if (isPruned(e, _checkCorrals) == false && insertVisited(e))
+            {
+              if (isSolved(e))
+              {
+                thread.isSolutionFound = true;
+                thread.solution = node_t{ (uint32_t)node, push };
+                isSolutionFound.store(true, std::memory_order_relaxed);
+              }
+
+              // Storing the child
+              thread.parents.push_back(node_t{ (uint32_t)node, push });
+              thread.states.resize(thread.states.size() + _stateSize);
+              jaffarCommon::serializer::Contiguous s(&thread.states[thread.states.size() - _stateSize], _stateSize);
+              e.serializeState(s);
+            }
+
+            e.undoState(delta);
+            if (thread.isSolutionFound) break;
+          }
+        }
+
+        expandedNodes.fetch_add(thread.expandedNodes - chunkExpandedNodes, std::memory_order_relaxed);
+      }
+    }
+
+    for (const auto& thread : _threads)
+    {
+      _stats.expandedNodes += thread.expandedNodes;
+      _stats.generatedNodes += thread.generatedNodes;
+    }
+
+    return isNodeLimitHit.load();
+  }
+
+  const nlohmann::json& _config;
+  const size_t _maxNodes;
+  const bool _checkCorrals;
+  searchStats_t& _stats;
+  std::unique_ptr<jaffar::StateHashSet> _visited;
+  std::unique_ptr<jaffar::BoxConfigurationSet> _configurations;
+  size_t _stateSize;
+  std::vector<threadData_t> _threads;
+  std::vector<std::vector<node_t>> _parents;
+  std::vector<uint8_t> _frontier;
+};
+
+// Breadth-first search over pushes whose frontiers and visited states are kept on disk (see StateStore), for levels that do not
+// fit in memory. Every completed depth is checkpointed, so an interrupted search can be resumed from the same directory
+static bool runDiskBFS(jaffar::EmuInstance& e, const std::string& storeDirectory, const size_t segmentRecordCount, const bool resume, const size_t maxNodes, const bool checkCorrals, std::vector<quickerBan::Room::push_t>& solution, searchStats_t& stats)
+{
+  const auto serializeState = [&](jaffarCommon::serializer::Base& s) { e.serializeState(s); };
+  const auto rootHash = e.getStateHash();
+  if (isSolved(e)) return true;
+
+  jaffar::StateStore store(storeDirectory, e.getStateSize(), segmentRecordCount);
+  if (resume && store.resume())
+  {
+    if (store.getRootHash() != rootHash) JAFFAR_THROW_LOGIC("The search stored in '%s' is for a different room\n", storeDirectory.c_str());
+    printf("[] Resuming from depth:                    %lu\n", store.getDepth());
+  }
+  else store.start(rootHash, serializeState);
+
+  std::vector<quickerBan::Room::push_t> pushes;
+  quickerBan::Room::moveDelta_t delta;
+  while (store.getFrontierSize() > 0)
+  {
+    if (maxNodes > 0 && stats.expandedNodes >= maxNodes) { stats.hitNodeLimit = true; return false; }
+    stats.iterations++;
+
+    for (size_t node = 0; node < store.getFrontierSize(); node++)
+    {
+      jaffarCommon::deserializer::Contiguous d(store.getFrontierState(node), e.getStateSize());
+      e.deserializeState(d);
+      const auto parentHash = store.getFrontierHeader(node).hash;
+      stats.expandedNodes++;
+
+      e.getPushes(pushes);
+      for (const auto& push : pushes)
+      {
+        e.advancePush(push, delta);
+        stats.generatedNodes++;
+
+        if (isPruned(e, checkCorrals) == false)
+        {
+          // Rebuilding the solution by looking up each parent in the previous depths
+          if (isSolved(e))
+          {
+            solution.push_back(push);
+            jaffar::StateStore::recordHeader_t header;
+            auto hash = parentHash;
+            for (size_t depth = store.getDepth(); depth > 0; depth--)
+            {
+              if (store.findRecord(depth, hash, header) == false) JAFFAR_THROW_RUNTIME("[Error] State store is missing a parent state at depth %lu", depth);
+              solution.push_back(header.push);
+              hash = header.parentHash;
+            }
+            std::reverse(solution.begin(), solution.end());
+            return true;
+          }
+
+          store.append(e.getStateHash(), parentHash, push, serializeState);
+        }
+
+        e.undoState(delta);
+      }
+    }
+
+    store.finishDepth();
+  }
+
+  return false;
+}
+
+// Bidirectional breadth-first search: forward over pushes from the initial state, and backward over pulls from every solved
+// state, expanding one depth at a time of whichever side has the smaller frontier. With pusher normalization, states that only
+// differ in where the pusher stands within its area share their hash, so each side looks its new states up in the other's
+// visited table, and the first match joins the two halves. The backward half is replayed forwards by reverting its pulls
+class BidirectionalBFS
+{
+  public:
+
+  BidirectionalBFS(const size_t maxNodes, searchStats_t& stats) : _maxNodes(maxNodes), _stats(stats) {}
+
+  bool run(jaffar::EmuInstance& e, const bool checkCorrals, std::vector<quickerBan::Room::push_t>& solution)
+  {
+    if (isSolved(e)) return true;
+    _stateSize = e.getStateSize();
+
+    // Storing the roots: the initial state forwards, and a solved state per pusher area backwards
+    addRoot(e, _forward);
+    std::vector<quickerBan::cellIndex_t> solvedStarts;
+    e.getSolvedPusherStarts(solvedStarts);
+    for (const auto start : solvedStarts)
+    {
+      e.setSolvedState(start);
+      addRoot(e, _backward);
+    }
+
+    // Checking whether the initial state is already a solved one
+    const auto rootMatch = _backward.visited.find(_forwardRootHash);
+    if (rootMatch != _backward.visited.end()) return stitch(e, 0, rootMatch->second, solution);
+
+    while (_forward.frontier.empty() == false && _backward.frontier.empty() == false)
+    {
+      if (_maxNodes > 0 && _stats.expandedNodes >= _maxNodes) { _stats.hitNodeLimit = true; return false; }
+      _stats.iterations++;
+
+      uint32_t forwardNode, backwardNode;
+      const bool isForward = _forward.frontier.size() <= _backward.frontier.size();
+      const bool isMeeting = isForward ? expandForward(e, checkCorrals, forwardNode, backwardNode) : expandBackward(e, forwardNode, backwardNode);
+      if (isMeeting) return stitch(e, forwardNode, backwardNode, solution);
+    }
+
+    return false;
+  }
+
+  private:
+
+  // How the node was reached: its parent node and the push (or pull, backwards) applied to it. Roots have no parent
+  struct node_t
+  {
+    uint32_t parent;
+    quickerBan::Room::push_t push;
+  };
+
+  static constexpr uint32_t noParent = std::numeric_limits<uint32_t>::max();
+
+  // One search direction. The current frontier is the nodes from frontierBegin on, whose states are held in order
+  struct side_t
+  {
+    std::vector<node_t> nodes;
+    std::unordered_map<jaffarCommon::hash::hash_t, uint32_t, stateHashHasher_t> visited;
+    size_t frontierBegin = 0;
+    std::vector<uint8_t> frontier;
+    std::vector<uint8_t> next;
+  };
+
+  void addRoot(jaffar::EmuInstance& e, side_t& side)
+  {
+    const auto hash = e.getStateHash();
+    if (&side == &_forward) _forwardRootHash = hash;
+    if (side.visited.emplace(hash, (uint32_t)side.nodes.size()).second == false) return;
+    side.nodes.push_back(node_t{ noParent, quickerBan::Room::push_t{ 0, 0, 0 } });
+    storeState(e, side.frontier);
+  }
+
+  __INLINE__ void storeState(jaffar::EmuInstance& e, std::vector<uint8_t>& states)
+  {
+    states.resize(states.size() + _stateSize);
+    jaffarCommon::serializer::Contiguous s(&states[states.size() - _stateSize], _stateSize);
+    e.serializeState(s);
+  }
+
+  __INLINE__ void loadState(jaffar::EmuInstance& e, const side_t& side, const size_t node)
+  {
+    jaffarCommon::deserializer::Contiguous d(&side.frontier[(node - side.frontierBegin) * _stateSize], _stateSize);
+    e.deserializeState(d);
+  }
+
+  // Records the state just reached from the given node, if new to this side. Returns true if the other side reached it already
+  __INLINE__ bool addChild(jaffar::EmuInstance& e, side_t& side, const side_t& other, const size_t parent, const quickerBan::Room::push_t& push, uint32_t& node, uint32_t& otherNode)
+  {
+    const auto hash = e.getStateHash();
+    const auto [it, isNew] = side.visited.emplace(hash, (uint32_t)side.nodes.size());
+    if (isNew == false) return false;
+
+    side.nodes.push_back(node_t{ (uint32_t)parent, push });
+    storeState(e, side.next);
+
+    const auto match = other.visited.find(hash);
+    if (match == other.visited.end()) return false;
+    node = it->second;
+    otherNode = match->second;
+    return true;
+  }
+
+  // Makes the states gathered in the next buffer the new frontier
+  __INLINE__ void advanceFrontier(side_t& side, const size_t frontierEnd)
+  {
+    side.frontierBegin = frontierEnd;
+    std::swap(side.frontier, side.next);
+    side.next.clear();
+  }
+
+  bool expandForward(jaffar::EmuInstance& e, const bool checkCorrals, uint32_t& forwardNode, uint32_t& backwardNode)
+  {
+    const size_t frontierEnd = _forward.nodes.size();
+    for (size_t node = _forward.frontierBegin; node < frontierEnd; node++)
+    {
+      loadState(e, _forward, node);
+      _stats.expandedNodes++;
+
+      e.getPushes(_moves);
+      for (const auto& push : _moves)
+      {
+        e.advancePush(push, _delta);
+        _stats.generatedNodes++;
+        const bool isMeeting = isPruned(e, checkCorrals) == false && addChild(e, _forward, _backward, node, push, forwardNode, backwardNode);
+        e.undoState(_delta);
+        if (isMeeting) return true;
+      }
+    }
+
+    advanceFrontier(_forward, frontierEnd);
+    return false;
+  }
+
+  // Pulls cannot be undone in place, so the parent is reloaded before each one
+  bool expandBackward(jaffar::EmuInstance& e, uint32_t& forwardNode, uint32_t& backwardNode)
+  {
+    const size_t frontierEnd = _backward.nodes.size();
+    for (size_t node = _backward.frontierBegin; node < frontierEnd; node++)
+    {
+      loadState(e, _backward, node);
+      _stats.expandedNodes++;
+
+      e.getPulls(_moves);
+      for (size_t i = 0; i < _moves.size(); i++)
+      {
+        if (i > 0) loadState(e, _backward, node);
+        e.advancePull(_moves[i]);
+        _stats.generatedNodes++;
+        if (addChild(e, _backward, _forward, node, _moves[i], backwardNode, forwardNode)) return true;
+      }
+    }
+
+    advanceFrontier(_backward, frontierEnd);
+    return false;
+  }
+
+  // Joins the pushes leading to the meeting state with the pushes reverting, from last to first, the pulls leading to it
+  bool stitch(jaffar::EmuInstance& e, const uint32_t forwardNode, const uint32_t backwardNode, std::vector<quickerBan::Room::push_t>& solution)
+  {
+    for (uint32_t node = forwardNode; _forward.nodes[node].parent != noParent; node = _forward.nodes[node].parent) solution.push_back(_forward.nodes[node].push);
+    std::reverse(solution.begin(), solution.end());
+    for (uint32_t node = backwardNode; _backward.nodes[node].parent != noParent; node = _backward.nodes[node].parent) solution.push_back(e.getReversePush(_backward.nodes[node].push));
+    return true;
+  }
+
+  const size_t _maxNodes;
+  searchStats_t& _stats;
+  size_t _stateSize;
+  jaffarCommon::hash::hash_t _forwardRootHash;
+  side_t _forward;
+  side_t _backward;
+  std::vector<quickerBan::Room::push_t> _moves;
+  quickerBan::Room::moveDelta_t _delta;
+};
+
+int main(int argc, char *argv[])
+{
+  // Parsing command line arguments
+  argparse::ArgumentParser program("solver", "1.0");
+
+  program.add_argument("scriptFile")
+    .help("Path to the script file describing the room to solve.")
+    .required();
+
+  program.add_argument("--algorithm")
+    .help("Search algorithm to use. Possible values: 'AStar': A* with a transposition table of every state, 'IDAStar': iterative deepening A*, which only keeps the current path and a bounded transposition table.")
+    .default_value(std::string("AStar"));
+
+  program.add_argument("--outputFile")
+    .help("Path to write the solution (.sol) to.")
+    .default_value(std::string("solution.sol"));
+
+  program.add_argument("--maxNodes")
+    .help("Maximum number of nodes to expand before giving up (0: unlimited).")
+    .default_value(size_t(0))
+    .scan<'u', size_t>();
+
+  program.add_argument("--maxTableEntries")
+    .help("Maximum number of entries in the IDA* transposition table, or capacity of the BFS visited set.")
+    .default_value(size_t(1 << 22))
+    .scan<'u', size_t>();
+
+  program.add_argument("--visitedStore")
+    .help("How BFS keeps the visited states. Possible values: 'StateHash': a fixed-capacity table of state hashes, 'BoxConfiguration': each box configuration once, with the pusher areas it was reached with.")
+    .default_value(std::string("StateHash"));
+
+  program.add_argument("--storeDirectory")
+    .help("Directory where DiskBFS keeps its states and checkpoints.")
+    .default_value(std::string("stateStore"));
+
+  program.add_argument("--segmentSize")
+    .help("Number of states per DiskBFS segment, each sorted in the background once full.")
+    .default_value(size_t(1 << 20))
+    .scan<'u', size_t>();
+
+  program.add_argument("--resume")
+  .help("Resumes the DiskBFS search checkpointed in the store directory, if any")
+  .default_value(false)
+  .implicit_value(true);
+
+  program.add_argument("--checkCorrals")
+  .help("Prunes states with a corral deadlock, at the cost of a slower expansion")
+  .default_value(false)
+  .implicit_value(true);
+
+  // Try to parse arguments
+  try { program.parse_args(argc, argv); } catch (const std::runtime_error &err) { JAFFAR_THROW_LOGIC("%s\n%s", err.what(), program.help().str().c_str()); }
+
+  // Getting test script file path
+  const auto scriptFilePath = program.get<std::string>("scriptFile");
+
+  // Getting path where to save the solution
+  const auto outputFile = program.get<std::string>("--outputFile");
+
+  // Getting search algorithm
+  const auto algorithm = program.get<std::string>("--algorithm");
+
+  bool algorithmRecognized = false;
+  if (algorithm == "AStar") algorithmRecognized = true;
+  if (algorithm == "IDAStar") algorithmRecognized = true;
+  if (algorithm == "BFS") algorithmRecognized = true;
+  if (algorithm == "DiskBFS") algorithmRecognized = true;
+  if (algorithm == "Bidirectional") algorithmRecognized = true;
+  if (algorithmRecognized == false) JAFFAR_THROW_LOGIC("Unrecognized algorithm: %s\n", algorithm.c_str());
+
+  // Getting search limits
+  const auto maxNodes = program.get<size_t>("--maxNodes");
+  const auto maxTableEntries = program.get<size_t>("--maxTableEntries");
+  const auto checkCorrals = program.get<bool>("--checkCorrals");
+
+  // Getting visited store
+  const auto visitedStore = program.get<std::string>("--visitedStore");
+
+  bool visitedStoreRecognized = false;
+  if (visitedStore == "StateHash") visitedStoreRecognized = true;
+  if (visitedStore == "BoxConfiguration") visitedStoreRecognized = true;
+  if (visitedStoreRecognized == false) JAFFAR_THROW_LOGIC("Unrecognized visited store: %s\n", visitedStore.c_str());
+
+  // Getting disk store settings
+  const auto storeDirectory = program.get<std::string>("--storeDirectory");
+  const auto segmentSize = program.get<size_t>("--segmentSize");
+  const auto resume = program.get<bool>("--resume");
+
+  // Loading script file
+  std::string configJsRaw;
+  if (jaffarCommon::file::loadStringFromFile(configJsRaw, scriptFilePath) == false) JAFFAR_THROW_LOGIC("Could not find/read script file: %s\n", scriptFilePath.c_str());
+
+  // Parsing script. The search is over pushes, so states differing only in where the pusher stands within its area are the same
+  auto configJs = nlohmann::json::parse(configJsRaw);
+  configJs["Normalize Pusher Position"] = true;
+
+  // Push macros make one search step push several times. A* and IDA* charge each step the pushes it made, but the breadth-first
+  // searches advance one depth per step (and the backward half of the bidirectional one undoes single pushes), so they would no
+  // longer find the fewest pushes. Macros are only used by A* and IDA*
+  if (algorithm != "AStar" && algorithm != "IDAStar") configJs["Use Push Macros"] = false;
+
+  // Creating and initializing emulator instance
+  auto e = jaffar::EmuInstance(configJs);
+  e.initialize();
+
+  // Printing search information
+  printf("[] -----------------------------------------\n");
+  printf("[] Running Script:                         '%s'\n", scriptFilePath.c_str());
+  printf("[] Algorithm:                              '%s'\n", algorithm.c_str());
+  if (algorithm == "BFS") printf("[] Threads:                                %d\n", omp_get_max_threads());
+  printf("[] Emulation Core:                         '%s'\n", e.getCoreName().c_str());
+  printf("[] Boxes:                                  %lu\n", e.getLevel()->getBoxCount());
+  printf("[] Push Macros:                            %s\n", e.getLevel()->isPushMacroEnabled() ? "Enabled" : "Disabled");
+  printf("[] Initial Heuristic:                      %u\n", getHeuristic(e));
+  printf("[] ********** Running Search **********\n");
+
+  fflush(stdout);
+
+  // Running search
+  searchStats_t stats;
+  std::vector<quickerBan::Room::push_t> solution;
+  auto t0 = std::chrono::high_resolution_clock::now();
+  bool isSolutionFound = false;
+  if (algorithm == "AStar") isSolutionFound = runAStar(e, maxNodes, checkCorrals, solution, stats);
+  if (algorithm == "IDAStar") isSolutionFound = IDAStar(e, maxNodes, maxTableEntries, checkCorrals, stats).run(solution);
+  if (algorithm == "BFS") isSolutionFound = ParallelBFS(configJs, maxNodes, maxTableEntries, visitedStore == "BoxConfiguration", checkCorrals, stats).run(e, solution);
+  if (algorithm == "DiskBFS") isSolutionFound = runDiskBFS(e, storeDirectory, segmentSize, resume, maxNodes, checkCorrals, solution, stats);
+  if (algorithm == "Bidirectional") isSolutionFound = BidirectionalBFS(maxNodes, stats).run(e, checkCorrals, solution);
+  auto tf = std::chrono::high_resolution_clock::now();
+
+  // Calculating running time
+  auto dt = std::chrono::duration_cast<std::chrono::nanoseconds>(tf - t0).count();
+  double elapsedTimeSeconds = (double)dt * 1.0e-9;
+
+  // Getting peak memory usage (in kilobytes on Linux)
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  // Printing search results
+  printf("[] Elapsed time:                           %3.3fs\n", elapsedTimeSeconds);
+  printf("[] Expanded Nodes:                         %lu\n", stats.expandedNodes);
+  printf("[] Generated Nodes:                        %lu\n", stats.generatedNodes);
+  if (algorithm != "AStar") printf("[] Iterations:                             %lu\n", stats.iterations);
+  printf("[] Performance:                            %.3f nodes / s\n", (double)stats.expandedNodes / elapsedTimeSeconds);
+  printf("[] Peak Memory:                            %.3f MB\n", (double)usage.ru_maxrss / 1024.0);
+
+  // Saving the deadlock patterns learned during the search, if enabled
+  if (e.getDeadlockPatternCache() != nullptr)
+  {
+    printf("[] Deadlock Patterns:                      %lu\n", e.getDeadlockPatternCache()->size());
+    e.saveDeadlockPatternCache();
+  }
+
+  if (isSolutionFound == false)
+  {
+    printf("[] Result:                                 %s\n", stats.hitNodeLimit ? "Node limit reached" : "No solution");
+    return 1;
+  }
+
+  // Replaying the solution from the start to expand each push, and the macro moves it led to, into the inputs that perform them.
+  // The level is copied first, since re-initializing replaces the room holding it
+  const auto level = e.getLevel();
+  e.initialize(level);
+  std::string solutionString;
+  for (const auto& push : solution)
+  {
+    e.getPushInputString(push, solutionString);
+    e.advancePush(push);
+    e.getLastMacroInputString(solutionString);
+  }
+
+  printf("[] Result:                                 Solved\n");
+  // With push macros a single search step may push several times, so pushes are counted from the inputs
+  const auto pushCount = std::count_if(solutionString.begin(), solutionString.end(), [](const char c) { return std::isupper(c); });
+  printf("[] Solution Pushes:                        %lu\n", (size_t)pushCount);
+  printf("[] Solution Moves:                         %lu\n", solutionString.size());
+  printf("[] Solution File:                          '%s'\n", outputFile.c_str());
+
+  // Saving solution
+  if (jaffarCommon::file::saveStringToFile(solutionString, outputFile.c_str()) == false) JAFFAR_THROW_LOGIC("Could not write solution file: %s\n", outputFile.c_str());
+
+  // If reached this point, everything ran ok
+  return 0;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <jaffarCommon/hash.hpp>
+#include <jaffarCommon/exceptions.hpp>
+
+namespace jaffar
+{
+
+// Fixed-capacity set of state hashes that any number of threads can insert into concurrently without locks. It uses open
+// addressing with linear probing over a power-of-two table of 64-bit slots: the first half of the hash is stored as the key, and
+// both halves are mixed to pick the starting slot, so wide hashes discriminate states with as many bits as the table index plus
+// 64 (64-bit hashes, whose second half is zero, still spread evenly). Slots are only ever claimed (never freed), which is all a
+// visited set needs and keeps every insertion a single compare-and-swap
+class StateHashSet
+{
+  public:
+
+  // The capacity is rounded up to a power of two
+  StateHashSet(const size_t capacity)
+  {
+    _capacity = 2;
+    _shift = 63;
+    while (_capacity < capacity) { _capacity <<= 1; _shift--; }
+    _mask = _capacity - 1;
+    _slots = std::make_unique<std::atomic<uint64_t>[]>(_capacity);
+    for (size_t i = 0; i < _capacity; i++) _slots[i].store(emptySlot, std::memory_order_relaxed);
+  }
+
+  ~StateHashSet() = default;
+
+  // Inserts the hash. Returns true if it was not in the set already
+  __INLINE__ bool insert(const jaffarCommon::hash::hash_t& hash)
+  {
+    // The empty value is reserved, so a key equal to it is remapped
+    const uint64_t key = hash.first == emptySlot ? 1 : hash.first;
+
+    size_t slot = ((hash.first ^ hash.second) * 0x9E3779B97F4A7C15ull) >> _shift;
+    for (size_t probes = 0; probes < _capacity; probes++)
+    {
+      uint64_t current = _slots[slot].load(std::memory_order_relaxed);
+      if (current == key) return false;
+
+      // Claiming an empty slot. If another thread claimed it first, its key may be ours
+      if (current == emptySlot)
+      {
+        if (_slots[slot].compare_exchange_strong(current, key, std::memory_order_relaxed)) { _size.fetch_add(1, std::memory_order_relaxed); return true; }
+        if (current == key) return false;
+      }
+
+      slot = (slot + 1) & _mask;
+    }
+
+    JAFFAR_THROW_RUNTIME("[Error] State hash set is full (%lu entries)", _capacity);
+  }
+
+  __INLINE__ size_t size() const { return _size.load(std::memory_order_relaxed); }
+  __INLINE__ size_t getCapacity() const { return _capacity; }
+
+  private:
+
+  static constexpr uint64_t emptySlot = 0;
+
+  std::unique_ptr<std::atomic<uint64_t>[]> _slots;
+  std::atomic<size_t> _size = 0;
+  size_t _capacity;
+  size_t _mask;
+  uint8_t _shift;
+};
+
+} // namespace jaffar
@@ -0,0 +1,371 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <numeric>
+#include <queue>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <jaffarCommon/hash.hpp>
+#include <jaffarCommon/exceptions.hpp>
+#include <jaffarCommon/file.hpp>
+#include <jaffarCommon/serializers/contiguous.hpp>
+#include <jaffarCommon/deserializers/contiguous.hpp>
+#include "room.hpp"
+
+namespace jaffar
+{
+
+// Disk-backed store for a breadth-first search over pushes that does not fit in memory. States are kept in the format saveState()
+// produces, and all files live in one directory:
+//
+//  - frontier.<depth>: the states first reached at that depth, sorted by hash. Each record holds the state's hash, its parent's
+//    hash and the push that reached it, followed by the serialized state. Kept for every depth, to rebuild the solution
+//  - visited.<depth>: the sorted hashes of every state reached up to that depth
+//  - segment.<n>: append-only, memory-mapped buffers receiving the children generated at the current depth, duplicates included.
+//    Each one is sorted and deduplicated in the background as soon as it fills up (into sorted.<n>)
+//  - checkpoint: the last completed depth, rewritten atomically once its files are complete, from which a search resumes
+//
+// Duplicates are detected late: finishDepth() merges the sorted segments against the visited file, which yields the next frontier
+// (only unseen states) and the next visited file in a single sequential pass
+class StateStore
+{
+  public:
+
+  // Record header preceding each serialized state
+  struct recordHeader_t
+  {
+    jaffarCommon::hash::hash_t hash;
+    jaffarCommon::hash::hash_t parentHash;
+    quickerBan::Room::push_t push;
+  };
+
+  StateStore(const std::string& directory, const size_t stateSize, const size_t segmentRecordCount)
+    : _directory(directory), _stateSize(stateSize), _segmentRecordCount(segmentRecordCount)
+  {
+    _recordSize = (sizeof(recordHeader_t) + _stateSize + alignof(recordHeader_t) - 1) & ~(alignof(recordHeader_t) - 1);
+    mkdir(_directory.c_str(), 0755);
+  }
+
+  ~StateStore()
+  {
+    unmapFrontier();
+    if (_segment != nullptr) munmap(_segment, _segmentRecordCount * _recordSize);
+    if (_segmentFd >= 0) close(_segmentFd);
+    for (auto& sortJob : _sortJobs) sortJob.wait();
+  }
+
+  // Starts a new search from the given root state, discarding any previous one
+  template <typename F>
+  void start(const jaffarCommon::hash::hash_t& rootHash, F&& serializeState)
+  {
+    // Writing the root as the whole first frontier, and as the only visited state
+    std::vector<uint8_t> record(_recordSize, 0);
+    writeRecord(record.data(), rootHash, rootHash, quickerBan::Room::push_t{ 0, 0, 0 }, serializeState);
+    writeFile(getPath("frontier", 0), record.data(), _recordSize);
+    writeFile(getPath("visited", 0), &rootHash, sizeof(rootHash));
+
+    _rootHash = rootHash;
+    _depth = 0;
+    saveCheckpoint();
+    mapFrontier();
+  }
+
+  // Resumes the search saved in the directory, if any. Returns false if there is no checkpoint
+  bool resume()
+  {
+    std::string checkpoint;
+    if (jaffarCommon::file::loadStringFromFile(checkpoint, getPath("checkpoint")) == false) return false;
+    if (checkpoint.size() != checkpointSize) JAFFAR_THROW_RUNTIME("[Error] Corrupt checkpoint in '%s'", _directory.c_str());
+
+    jaffarCommon::deserializer::Contiguous d(checkpoint.data(), checkpoint.size());
+    uint64_t magic, stateSize;
+    d.pop(&magic, sizeof(magic));
+    d.pop(&stateSize, sizeof(stateSize));
+    d.pop(&_depth, sizeof(_depth));
+    d.pop(&_rootHash, sizeof(_rootHash));
+    if (magic != checkpointMagic) JAFFAR_THROW_RUNTIME("[Error] Corrupt checkpoint in '%s'", _directory.c_str());
+    if (stateSize != _stateSize) JAFFAR_THROW_RUNTIME("[Error] Checkpoint in '%s' was saved with a state size of %lu, but the current one is %lu", _directory.c_str(), stateSize, _stateSize);
+
+    // Discarding the children generated after the checkpoint
+    for (size_t n = 0;; n++)
+    {
+      const bool hasSegment = unlink(getPath("segment", n).c_str()) == 0;
+      const bool hasSorted = unlink(getPath("sorted", n).c_str()) == 0;
+      if (hasSegment == false && hasSorted == false) break;
+    }
+
+    mapFrontier();
+    return true;
+  }
+
+  __INLINE__ size_t getDepth() const { return _depth; }
+  __INLINE__ const jaffarCommon::hash::hash_t& getRootHash() const { return _rootHash; }
+  __INLINE__ size_t getFrontierSize() const { return _frontierSize; }
+  __INLINE__ const recordHeader_t& getFrontierHeader(const size_t i) const { return *(const recordHeader_t*)&_frontier[i * _recordSize]; }
+  __INLINE__ const uint8_t* getFrontierState(const size_t i) const { return &_frontier[i * _recordSize + sizeof(recordHeader_t)]; }
+
+  // Appends a state generated at the next depth, duplicates included, writing it through the given serializer callback
+  template <typename F>
+  __INLINE__ void append(const jaffarCommon::hash::hash_t& hash, const jaffarCommon::hash::hash_t& parentHash, const quickerBan::Room::push_t& push, F&& serializeState)
+  {
+    if (_segment == nullptr) openSegment();
+    writeRecord(&_segment[_segmentSize * _recordSize], hash, parentHash, push, serializeState);
+    if (++_segmentSize == _segmentRecordCount) sealSegment();
+  }
+
+  // Completes the next depth: waits for the segments to be sorted, merges them against the visited states into the next frontier
+  // and visited files, and checkpoints. Returns the size of the new frontier
+  size_t finishDepth()
+  {
+    if (_segment != nullptr) sealSegment();
+
+    // Opening the sorted segments
+    std::vector<mappedFile_t> segments;
+    for (size_t n = 0; n < _sortJobs.size(); n++)
+    {
+      const size_t recordCount = _sortJobs[n].get();
+      segments.push_back(mappedFile_t(getPath("sorted", n), recordCount * _recordSize));
+    }
+    _sortJobs.clear();
+
+    const size_t depth = _depth + 1;
+    auto visited = mappedFile_t(getPath("visited", _depth));
+    const auto visitedHashes = (const jaffarCommon::hash::hash_t*)visited.data;
+    const size_t visitedCount = visited.size / sizeof(jaffarCommon::hash::hash_t);
+    outputFile_t frontierOutput(getPath("frontier", depth));
+    outputFile_t visitedOutput(getPath("visited", depth));
+
+    // Merging the segments in hash order, dropping duplicates and states already visited
+    const auto getHash = [&](const size_t segment, const size_t record) -> const jaffarCommon::hash::hash_t& { return *(const jaffarCommon::hash::hash_t*)&segments[segment].data[record * _recordSize]; };
+    typedef std::pair<jaffarCommon::hash::hash_t, size_t> entry_t;
+    std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> heads;
+    std::vector<size_t> positions(segments.size(), 0);
+    for (size_t s = 0; s < segments.size(); s++) if (segments[s].size > 0) heads.push({ getHash(s, 0), s });
+
+    size_t visitedPos = 0;
+    size_t frontierSize = 0;
+    bool hasLast = false;
+    jaffarCommon::hash::hash_t last;
+    while (heads.empty() == false)
+    {
+      const auto [hash, s] = heads.top();
+      heads.pop();
+
+      if (hasLast == false || hash != last)
+      {
+        while (visitedPos < visitedCount && visitedHashes[visitedPos] < hash) visitedOutput.write(&visitedHashes[visitedPos++], sizeof(hash));
+        if (visitedPos == visitedCount || visitedHashes[visitedPos] != hash)
+        {
+          frontierOutput.write(&segments[s].data[positions[s] * _recordSize], _recordSize);
+          visitedOutput.write(&hash, sizeof(hash));
+          frontierSize++;
+        }
+        last = hash;
+        hasLast = true;
+      }
+
+      if (++positions[s] * _recordSize < segments[s].size) heads.push({ getHash(s, positions[s]), s });
+    }
+    if (visitedPos < visitedCount) visitedOutput.write(&visitedHashes[visitedPos], (visitedCount - visitedPos) * sizeof(jaffarCommon::hash::hash_t));
+
+    frontierOutput.close();
+    visitedOutput.close();
+    visited.unmap();
+    for (size_t n = 0; n < segments.size(); n++) { segments[n].unmap(); unlink(getPath("sorted", n).c_str()); }
+
+    // Moving to the next depth. The previous visited file is only removed once the checkpoint no longer refers to it
+    unmapFrontier();
+    _depth = depth;
+    saveCheckpoint();
+    unlink(getPath("visited", depth - 1).c_str());
+    mapFrontier();
+
+    return frontierSize;
+  }
+
+  // Looks up a state reached at the given depth by its hash, for rebuilding the solution. Returns false if not found
+  bool findRecord(const size_t depth, const jaffarCommon::hash::hash_t& hash, recordHeader_t& header) const
+  {
+    auto frontier = mappedFile_t(getPath("frontier", depth));
+    size_t low = 0, high = frontier.size / _recordSize;
+    while (low < high)
+    {
+      const size_t mid = (low + high) / 2;
+      const auto& midHeader = *(const recordHeader_t*)&frontier.data[mid * _recordSize];
+      if (midHeader.hash == hash) { header = midHeader; return true; }
+      if (midHeader.hash < hash) low = mid + 1; else high = mid;
+    }
+    return false;
+  }
+
+  private:
+
+  static constexpr uint64_t checkpointMagic = 0x5142434B50543031ull;
+  static constexpr size_t checkpointSize = 3 * sizeof(uint64_t) + sizeof(jaffarCommon::hash::hash_t);
+
+  // Read-only mapping of a whole file
+  struct mappedFile_t
+  {
+    mappedFile_t(const std::string& path, const size_t expectedSize = SIZE_MAX)
+    {
+      const int fd = open(path.c_str(), O_RDONLY);
+      if (fd < 0) JAFFAR_THROW_RUNTIME("[Error] Could not open state store file '%s'", path.c_str());
+      struct stat fileStat;
+      fstat(fd, &fileStat);
+      size = fileStat.st_size;
+      if (expectedSize != SIZE_MAX && size != expectedSize) JAFFAR_THROW_RUNTIME("[Error] State store file '%s' has an unexpected size", path.c_str());
+      if (size > 0) data = (const uint8_t*)mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+      close(fd);
+      if (data == MAP_FAILED) JAFFAR_THROW_RUNTIME("[Error] Could not map state store file '%s'", path.c_str());
+    }
+
+    mappedFile_t(mappedFile_t&& other) : data(other.data), size(other.size) { other.data = nullptr; }
+    ~mappedFile_t() { unmap(); }
+    void unmap() { if (data != nullptr) munmap((void*)data, size); data = nullptr; }
+
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+  };
+
+  // Sequential, buffered output file
+  struct outputFile_t
+  {
+    outputFile_t(const std::string& path) : _path(path)
+    {
+      _file = fopen(path.c_str(), "wb");
+      if (_file == nullptr) JAFFAR_THROW_RUNTIME("[Error] Could not create state store file '%s'", path.c_str());
+      setvbuf(_file, nullptr, _IOFBF, 1 << 20);
+    }
+
+    ~outputFile_t() { close(); }
+    void write(const void* data, const size_t size) { if (fwrite(data, 1, size, _file) != size) JAFFAR_THROW_RUNTIME("[Error] Could not write state store file '%s'", _path.c_str()); }
+    void close() { if (_file != nullptr) fclose(_file); _file = nullptr; }
+
+    std::string _path;
+    FILE* _file;
+  };
+
+  template <typename F>
+  __INLINE__ void writeRecord(uint8_t* record, const jaffarCommon::hash::hash_t& hash, const jaffarCommon::hash::hash_t& parentHash, const quickerBan::Room::push_t& push, F&& serializeState)
+  {
+    auto header = (recordHeader_t*)record;
+    header->hash = hash;
+    header->parentHash = parentHash;
+    header->push = push;
+    jaffarCommon::serializer::Contiguous s(&record[sizeof(recordHeader_t)], _stateSize);
+    serializeState(s);
+  }
+
+  std::string getPath(const std::string& name) const { return _directory + "/" + name; }
+  std::string getPath(const std::string& name, const size_t n) const { return getPath(name + "." + std::to_string(n)); }
+
+  void writeFile(const std::string& path, const void* data, const size_t size)
+  {
+    outputFile_t output(path);
+    output.write(data, size);
+  }
+
+  // Writes the checkpoint next to the old one and swaps it in, so a crash leaves either the old or the new one intact
+  void saveCheckpoint()
+  {
+    std::string checkpoint(checkpointSize, '\0');
+    jaffarCommon::serializer::Contiguous s(checkpoint.data(), checkpoint.size());
+    const uint64_t magic = checkpointMagic;
+    const uint64_t stateSize = _stateSize;
+    s.push(&magic, sizeof(magic));
+    s.push(&stateSize, sizeof(stateSize));
+    s.push(&_depth, sizeof(_depth));
+    s.push(&_rootHash, sizeof(_rootHash));
+
+    writeFile(getPath("checkpoint.tmp"), checkpoint.data(), checkpoint.size());
+    if (rename(getPath("checkpoint.tmp").c_str(), getPath("checkpoint").c_str()) != 0) JAFFAR_THROW_RUNTIME("[Error] Could not save checkpoint in '%s'", _directory.c_str());
+  }
+
+  void mapFrontier()
+  {
+    _frontierFile = std::make_unique<mappedFile_t>(getPath("frontier", _depth));
+    _frontier = _frontierFile->data;
+    _frontierSize = _frontierFile->size / _recordSize;
+  }
+
+  void unmapFrontier()
+  {
+    _frontierFile.reset();
+    _frontier = nullptr;
+    _frontierSize = 0;
+  }
+
+  // Creates the next segment at its full size and maps it for appending
+  void openSegment()
+  {
+    const auto path = getPath("segment", _sortJobs.size());
+    _segmentFd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (_segmentFd < 0 || ftruncate(_segmentFd, _segmentRecordCount * _recordSize) != 0) JAFFAR_THROW_RUNTIME("[Error] Could not create state store segment '%s'", path.c_str());
+    _segment = (uint8_t*)mmap(nullptr, _segmentRecordCount * _recordSize, PROT_READ | PROT_WRITE, MAP_SHARED, _segmentFd, 0);
+    if (_segment == MAP_FAILED) JAFFAR_THROW_RUNTIME("[Error] Could not map state store segment '%s'", path.c_str());
+    _segmentSize = 0;
+  }
+
+  // Trims the current segment to its used size and hands it to a background job that sorts and deduplicates it
+  void sealSegment()
+  {
+    munmap(_segment, _segmentRecordCount * _recordSize);
+    if (ftruncate(_segmentFd, _segmentSize * _recordSize) != 0) JAFFAR_THROW_RUNTIME("[Error] Could not trim state store segment");
+    close(_segmentFd);
+    _segment = nullptr;
+    _segmentFd = -1;
+
+    const size_t n = _sortJobs.size();
+    const size_t recordCount = _segmentSize;
+    _sortJobs.push_back(std::async(std::launch::async, [this, n, recordCount]() { return sortSegment(n, recordCount); }));
+  }
+
+  // Writes the unique records of a segment in hash order, and removes it. Returns the number of records written
+  size_t sortSegment(const size_t n, const size_t recordCount) const
+  {
+    auto segment = mappedFile_t(getPath("segment", n), recordCount * _recordSize);
+    const auto getHash = [&](const size_t record) -> const jaffarCommon::hash::hash_t& { return *(const jaffarCommon::hash::hash_t*)&segment.data[record * _recordSize]; };
+
+    std::vector<uint32_t> order(recordCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](const uint32_t a, const uint32_t b) { return getHash(a) < getHash(b); });
+
+    outputFile_t output(getPath("sorted", n));
+    size_t uniqueCount = 0;
+    for (size_t i = 0; i < recordCount; i++) if (i == 0 || getHash(order[i]) != getHash(order[i - 1]))
+    {
+      output.write(&segment.data[order[i] * _recordSize], _recordSize);
+      uniqueCount++;
+    }
+
+    segment.unmap();
+    unlink(getPath("segment", n).c_str());
+    return uniqueCount;
+  }
+
+  const std::string _directory;
+  const size_t _stateSize;
+  const size_t _segmentRecordCount;
+  size_t _recordSize;
+  uint64_t _depth = 0;
+  jaffarCommon::hash::hash_t _rootHash;
+
+  std::unique_ptr<mappedFile_t> _frontierFile;
+  const uint8_t* _frontier = nullptr;
+  size_t _frontierSize = 0;
+
+  int _segmentFd = -1;
+  uint8_t* _segment = nullptr;
+  size_t _segmentSize = 0;
+  std::vector<std::future<size_t>> _sortJobs;
+};
+
+} // namespace jaffar
@@ -28,7 +28,7 @@ int main(int argc, char *argv[])
     .required();
 
   program.add_argument("--cycleType")
-    .help("Specifies the emulation actions to be performed per each input. Possible values: 'Simple': performs only advance state, 'Rerecord': performs load/advance/save, and 'Full': performs load/advance/save/advance.")
+    .help("Specifies the emulation actions to be performed per each input. Possible values: 'Simple': performs only advance state, 'Rerecord': performs load/advance/save, 'Undo': performs advance/undo/advance, and 'Full': performs load/advance/save/advance.")
     .default_value(std::string("Simple"));
 
   program.add_argument("--hashOutputFile")
@@ -55,6 +55,7 @@ int main(int argc, char *argv[])
   bool cycleTypeRecognized = false;
   if (cycleType == "Simple") cycleTypeRecognized = true;
   if (cycleType == "Rerecord") cycleTypeRecognized = true;
+  if (cycleType == "Undo") cycleTypeRecognized = true;
   if (cycleTypeRecognized == false) JAFFAR_THROW_LOGIC("Unrecognized cycle type: %s\n", cycleType.c_str());
 
   // Getting warmup setting
@@ -130,6 +131,10 @@ int main(int argc, char *argv[])
   bool doPreAdvance = cycleType == "Rerecord";
   bool doDeserialize = cycleType == "Rerecord";
   bool doSerialize = cycleType == "Rerecord";
+  bool doUndo = cycleType == "Undo";
+
+  // Storage for the move delta, used for undoing
+  quickerBan::Room::moveDelta_t moveDelta;
 
   // Actually running the sequence
   auto t0 = std::chrono::high_resolution_clock::now();
@@ -138,6 +143,12 @@ int main(int argc, char *argv[])
     // e.printInfo();
     
     if (doPreAdvance == true) e.advanceState(input);
+
+    if (doUndo == true)
+    {
+      e.advanceState(input, moveDelta);
+      e.undoState(moveDelta);
+    }
     
     if (doDeserialize == true)
     {